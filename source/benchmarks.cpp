@@ -0,0 +1,376 @@
+// This software is in the public domain. Where that dedication is not
+// recognized, you are granted a perpetual, irrevocable license to copy,
+// distribute, and modify this file as you see fit.
+// https://github.com/ddiakopoulos/tinyply
+// Version 2.3
+
+// Read and write throughput of tinyply, over the bundled assets and generated grid meshes. Every
+// mesh is encoded as ascii, binary little-endian and binary big-endian, and each encoding is read
+// from a stream, from memory and from memory in parallel; with and without a list size hint; and
+// with all properties or just the vertex positions requested. Writes go to a stream that discards
+// its input, so only encoding is measured.
+//
+//   benchmarks [--assets <dir>] [--vertices <n>[,<n>...]] [--filter <substring>] [--repetitions <n>]
+//              [--csv] [--baseline <results.csv>] [--tolerance <fraction>]
+//
+// Each benchmark reports its fastest and median time over the repetitions. With `--baseline`, the
+// fastest times are compared against a previous `--csv` run, and the exit code is non-zero if any
+// benchmark got slower by more than `--tolerance` (0.1 by default). The default is a single
+// 1M-vertex mesh; use `--vertices 10000000,100000000` for large meshes.
+
+#include "tinyply.h"
+using namespace tinyply;
+
+#include "example-utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <map>
+
+struct options
+{
+    std::string assets;
+    std::vector<size_t> vertices = { 1000000 };
+    std::string filter;
+    size_t repetitions{ 5 };
+    bool csv{ false };
+    std::string baseline;
+    double tolerance{ 0.1 };
+};
+
+// Discards everything written to it
+struct null_buffer : public std::streambuf
+{
+    std::streamsize xsputn(const char *, std::streamsize n) override { return n; }
+    int_type overflow(int_type c) override { return c; }
+};
+
+// A group of properties exactly as `request_properties_from_element` returned it
+struct property_group
+{
+    std::string element;
+    std::vector<std::string> properties;
+    Type list_type{ Type::INVALID };
+    std::shared_ptr<PlyData> data;
+};
+
+// A mesh held in memory, ready to be written back out in any encoding
+struct mesh
+{
+    std::string name;
+    std::vector<uint8_t> storage; // the file the groups were read from, which they may point into
+    std::vector<property_group> groups;
+};
+
+// Requests every property of every element: adjacent scalar properties of one type together, as
+// users tend to ask for them, and each list on its own
+inline std::vector<property_group> request_all_properties(PlyFile & file, const uint32_t list_size_hint)
+{
+    std::vector<property_group> groups;
+    for (const auto & e : file.get_elements())
+    {
+        for (size_t i = 0; i < e.properties.size();)
+        {
+            property_group group;
+            group.element = e.name;
+            if (e.properties[i].isList)
+            {
+                group.properties.push_back(e.properties[i].name);
+                group.list_type = e.properties[i].listType;
+                group.data = file.request_properties_from_element(e.name, group.properties, list_size_hint);
+                ++i;
+            }
+            else
+            {
+                size_t j = i;
+                for (; j < e.properties.size() && !e.properties[j].isList && e.properties[j].propertyType == e.properties[i].propertyType; ++j) group.properties.push_back(e.properties[j].name);
+                group.data = file.request_properties_from_element(e.name, group.properties);
+                i = j;
+            }
+            groups.push_back(group);
+        }
+    }
+    return groups;
+}
+
+inline void add_to_file(const mesh & m, PlyFile & file)
+{
+    for (const auto & g : m.groups)
+    {
+        const PlyData & d = *g.data;
+        if (g.list_type == Type::INVALID)
+        {
+            file.add_properties_to_element(g.element, g.properties, d.t, d.count, d.buffer.get_const(), Type::INVALID, 0);
+        }
+        else if (d.offsetStride == 8)
+        {
+            file.add_list_property_to_element(g.element, g.properties.front(), d.t, d.count, d.buffer.get_const(), g.list_type, reinterpret_cast<const uint64_t *>(d.offsets.get_const()));
+        }
+        else if (d.offsetStride == 4)
+        {
+            file.add_list_property_to_element(g.element, g.properties.front(), d.t, d.count, d.buffer.get_const(), g.list_type, reinterpret_cast<const uint32_t *>(d.offsets.get_const()));
+        }
+        else
+        {
+            const size_t length = d.count ? d.buffer.size_bytes() / (d.count * tinyply::type_stride(d.t)) : 0;
+            file.add_properties_to_element(g.element, g.properties, d.t, d.count, d.buffer.get_const(), g.list_type, length);
+        }
+    }
+}
+
+inline mesh load_mesh(const std::string & name, std::vector<uint8_t> bytes)
+{
+    mesh m;
+    m.name = name;
+    m.storage = std::move(bytes);
+    PlyFile file;
+    if (!file.parse_header(m.storage.data(), m.storage.size())) throw std::runtime_error("failed to parse the header of " + name);
+    m.groups = request_all_properties(file, 0);
+    file.read(m.storage.data(), m.storage.size());
+    return m;
+}
+
+// A square grid of (at least) `vertex_count` positions with colors, two triangles per cell
+inline mesh make_grid_mesh(const size_t vertex_count)
+{
+    const size_t side = std::max<size_t>(2, static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(vertex_count)))));
+    std::vector<float3> positions(side * side);
+    std::vector<uint8_t> colors(3 * side * side);
+    std::vector<uint3> triangles;
+    triangles.reserve(2 * (side - 1) * (side - 1));
+    for (size_t y = 0; y < side; ++y)
+    {
+        for (size_t x = 0; x < side; ++x)
+        {
+            const size_t i = y * side + x;
+            positions[i] = { x * 0.01f, y * 0.01f, std::sin(x * 0.05f) * std::cos(y * 0.05f) };
+            for (size_t c = 0; c < 3; ++c) colors[3 * i + c] = static_cast<uint8_t>((x + y) * (c + 1));
+            if (x + 1 < side && y + 1 < side)
+            {
+                const uint32_t a = static_cast<uint32_t>(i), b = a + 1, d = static_cast<uint32_t>(a + side), e = d + 1;
+                triangles.push_back({ a, b, e });
+                triangles.push_back({ a, e, d });
+            }
+        }
+    }
+
+    PlyFile file;
+    file.add_properties_to_element("vertex", { "x", "y", "z" }, Type::FLOAT32, positions.size(), reinterpret_cast<uint8_t *>(positions.data()), Type::INVALID, 0);
+    file.add_properties_to_element("vertex", { "red", "green", "blue" }, Type::UINT8, positions.size(), colors.data(), Type::INVALID, 0);
+    file.add_properties_to_element("face", { "vertex_indices" }, Type::UINT32, triangles.size(), reinterpret_cast<uint8_t *>(triangles.data()), Type::UINT8, 3);
+    std::ostringstream os;
+    file.write(os, true);
+    const std::string ply = os.str();
+    return load_mesh("grid" + std::to_string(side * side), std::vector<uint8_t>(ply.begin(), ply.end()));
+}
+
+struct encoding
+{
+    const char * name;
+    bool binary;
+    bool big_endian;
+};
+
+static const encoding encodings[] = { { "ascii", false, false }, { "binary_le", true, false }, { "binary_be", true, true } };
+
+inline std::vector<uint8_t> encode(const mesh & m, const encoding & enc)
+{
+    PlyFile file;
+    add_to_file(m, file);
+    file.set_big_endian(enc.big_endian);
+    std::ostringstream os;
+    file.write(os, enc.binary);
+    const std::string ply = os.str();
+    return std::vector<uint8_t>(ply.begin(), ply.end());
+}
+
+struct result
+{
+    std::string name;
+    size_t bytes;
+    double min_ms;
+    double median_ms;
+};
+
+class runner
+{
+    const options & opts;
+public:
+    std::vector<result> results;
+
+    explicit runner(const options & o) : opts(o)
+    {
+        if (opts.csv) std::cout << "name,bytes,min_ms,median_ms,mb_per_s" << std::endl;
+    }
+
+    // Times `fn`, which moves `bytes` bytes of ply data, unless `name` is filtered out
+    void run(const std::string & name, const size_t bytes, const std::function<void()> & fn)
+    {
+        if (!opts.filter.empty() && name.find(opts.filter) == std::string::npos) return;
+
+        std::vector<double> times;
+        for (size_t r = 0; r < opts.repetitions; ++r)
+        {
+            manual_timer timer;
+            timer.start();
+            fn();
+            timer.stop();
+            times.push_back(timer.get());
+        }
+        std::sort(times.begin(), times.end());
+        const result res = { name, bytes, times.front(), times[times.size() / 2] };
+        results.push_back(res);
+
+        const double mb_per_s = bytes / (res.min_ms * 1e3);
+        char line[512];
+        if (opts.csv) std::snprintf(line, sizeof(line), "%s,%zu,%.3f,%.3f,%.1f", name.c_str(), bytes, res.min_ms, res.median_ms, mb_per_s);
+        else std::snprintf(line, sizeof(line), "%-56s %10.3f ms %10.3f ms %9.1f MB/s", name.c_str(), res.min_ms, res.median_ms, mb_per_s);
+        std::cout << line << std::endl;
+    }
+};
+
+enum class input { stream, memory, parallel };
+
+inline void read_mesh(const std::vector<uint8_t> & bytes, const input in, const bool positions_only, const uint32_t list_size_hint)
+{
+    PlyFile file;
+    memory_stream stream(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+    if (in == input::stream) file.parse_header(stream);
+    else file.parse_header(bytes.data(), bytes.size());
+
+    if (positions_only) file.request_properties_from_element("vertex", { "x", "y", "z" });
+    else request_all_properties(file, list_size_hint);
+
+    if (in == input::stream) file.read(stream);
+    else if (in == input::memory) file.read(bytes.data(), bytes.size());
+    else file.read_parallel(bytes.data(), bytes.size());
+}
+
+inline void benchmark_mesh(runner & r, const mesh & m)
+{
+    bool has_positions = false;
+    for (const auto & g : m.groups)
+    {
+        auto has = [&](const char * name) { return std::find(g.properties.begin(), g.properties.end(), name) != g.properties.end(); };
+        has_positions |= g.element == "vertex" && has("x") && has("y") && has("z");
+    }
+
+    for (const encoding & enc : encodings)
+    {
+        const std::vector<uint8_t> bytes = encode(m, enc);
+        const std::string suffix = "/" + m.name + "/" + enc.name;
+
+        const struct { input in; const char * name; } inputs[] = { { input::stream, "stream" }, { input::memory, "memory" }, { input::parallel, "parallel" } };
+        for (const auto & in : inputs)
+        {
+            const std::string prefix = std::string("read") + suffix + "/" + in.name;
+            r.run(prefix + "/all", bytes.size(), [&]() { read_mesh(bytes, in.in, false, 0); });
+            r.run(prefix + "/all_hint3", bytes.size(), [&]() { read_mesh(bytes, in.in, false, 3); });
+            if (has_positions) r.run(prefix + "/xyz", bytes.size(), [&]() { read_mesh(bytes, in.in, true, 0); });
+        }
+
+        PlyFile file;
+        add_to_file(m, file);
+        file.set_big_endian(enc.big_endian);
+        r.run("write" + suffix, bytes.size(), [&]() { null_buffer sink; std::ostream os(&sink); file.write(os, enc.binary); });
+        r.run("write_parallel" + suffix, bytes.size(), [&]() { null_buffer sink; std::ostream os(&sink); file.write_parallel(os, enc.binary); });
+    }
+}
+
+// The fastest times of a previous `--csv` run, by benchmark name
+inline std::map<std::string, double> read_baseline(const std::string & path)
+{
+    std::map<std::string, double> baseline;
+    std::ifstream file(path);
+    if (!file) throw std::runtime_error("could not open baseline " + path);
+    std::string line;
+    std::getline(file, line); // column names
+    while (std::getline(file, line))
+    {
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        for (std::string field; std::getline(ss, field, ',');) fields.push_back(field);
+        if (fields.size() >= 3) baseline[fields[0]] = std::stod(fields[2]);
+    }
+    return baseline;
+}
+
+inline std::vector<size_t> parse_sizes(const std::string & list)
+{
+    std::vector<size_t> sizes;
+    std::stringstream ss(list);
+    for (std::string n; std::getline(ss, n, ',');) if (!n.empty()) sizes.push_back(std::stoull(n));
+    return sizes;
+}
+
+inline options parse_options(int argc, char * argv[])
+{
+    options opts;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        auto value = [&]() -> std::string
+        {
+            if (i + 1 >= argc) throw std::invalid_argument("missing value for " + arg);
+            return argv[++i];
+        };
+        if (arg == "--assets") opts.assets = value();
+        else if (arg == "--vertices") opts.vertices = parse_sizes(value());
+        else if (arg == "--filter") opts.filter = value();
+        else if (arg == "--repetitions") opts.repetitions = std::max<size_t>(1, std::stoull(value()));
+        else if (arg == "--csv") opts.csv = true;
+        else if (arg == "--baseline") opts.baseline = value();
+        else if (arg == "--tolerance") opts.tolerance = std::stod(value());
+        else throw std::invalid_argument("unknown argument " + arg);
+    }
+    return opts;
+}
+
+int main(int argc, char * argv[])
+{
+    try
+    {
+        const options opts = parse_options(argc, argv);
+        runner r(opts);
+
+        // Run from the build directory, or from the repository root (as under `bazel run`)
+        std::vector<std::string> asset_dirs = { "../assets", "assets" };
+        if (!opts.assets.empty()) asset_dirs = { opts.assets };
+
+        for (const std::string name : { "bunny", "sofa", "sofa_ascii", "elephant" })
+        {
+            std::vector<uint8_t> bytes;
+            for (const auto & dir : asset_dirs)
+            {
+                std::ifstream probe(dir + "/" + name + ".ply", std::ios::binary);
+                if (probe) { bytes = read_file_binary(dir + "/" + name + ".ply"); break; }
+            }
+            if (bytes.empty()) { std::cerr << "skipping " << name << ".ply, which was not found in the assets directory" << std::endl; continue; }
+            benchmark_mesh(r, load_mesh(name, std::move(bytes)));
+        }
+
+        for (const size_t n : opts.vertices) benchmark_mesh(r, make_grid_mesh(n));
+
+        if (!opts.baseline.empty())
+        {
+            const std::map<std::string, double> baseline = read_baseline(opts.baseline);
+            bool regressed = false;
+            for (const auto & res : r.results)
+            {
+                auto it = baseline.find(res.name);
+                if (it == baseline.end() || res.min_ms <= it->second * (1.0 + opts.tolerance)) continue;
+                std::cerr << "regression: " << res.name << " took " << res.min_ms << " ms, against " << it->second << " ms" << std::endl;
+                regressed = true;
+            }
+            if (regressed) return EXIT_FAILURE;
+        }
+    }
+    catch (const std::exception & e)
+    {
+        std::cerr << "benchmarks failed: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
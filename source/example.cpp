@@ -91,8 +91,8 @@ void read_ply_file(const std::string & filepath, const bool preload_into_memory
             std::cout << "\t[ply_header] element: " << e.name << " (" << e.size << ")" << std::endl;
             for (const auto & p : e.properties)
             {
-                std::cout << "\t[ply_header] \tproperty: " << p.name << " (type=" << tinyply::PropertyTable[p.propertyType].str << ")";
-                if (p.isList) std::cout << " (list_type=" << tinyply::PropertyTable[p.listType].str << ")";
+                std::cout << "\t[ply_header] \tproperty: " << p.name << " (type=" << tinyply::type_name(p.propertyType) << ")";
+                if (p.isList) std::cout << " (list_type=" << tinyply::type_name(p.listType) << ")";
                 std::cout << std::endl;
             }
         }
@@ -143,7 +143,7 @@ void read_ply_file(const std::string & filepath, const bool preload_into_memory
         if (colors)     std::cout << "\tRead " << colors->count << " total vertex colors " << std::endl;
         if (texcoords)  std::cout << "\tRead " << texcoords->count << " total vertex texcoords " << std::endl;
         if (faces)      std::cout << "\tRead " << faces->count     << " total faces (triangles) " << std::endl;
-        if (tripstrip)  std::cout << "\tRead " << (tripstrip->buffer.size_bytes() / tinyply::PropertyTable[tripstrip->t].stride) << " total indices (tristrip) " << std::endl;
+        if (tripstrip)  std::cout << "\tRead " << (tripstrip->buffer.size_bytes() / tinyply::type_stride(tripstrip->t)) << " total indices (tristrip) " << std::endl;
 
         // Example One: converting to your own application types
         {
@@ -152,6 +152,16 @@ void read_ply_file(const std::string & filepath, const bool preload_into_memory
             std::memcpy(verts.data(), vertices->buffer.get(), numVerticesBytes);
         }
 
+        // Example One and a half: using the data in place through a typed view (no copy). To skip
+        // tinyply's buffer altogether, pass your own memory (and stride) to `request_properties_from_element`.
+        {
+            if (vertices->t == tinyply::Type::FLOAT32)
+            {
+                float3 sum = { 0, 0, 0 };
+                for (const float3 & v : vertices->view<float3>()) { sum.x += v.x; sum.y += v.y; sum.z += v.z; }
+            }
+        }
+
         // Example Two: converting to your own application type
         {
             std::vector<float3> verts_floats;
@@ -241,7 +241,7 @@ TEST_CASE("check for invalid strings in the header")
 }
 
 // Reported via https://github.com/vilya/ply-parsing-perf
-TEST_CASE("check that variable length lists are unsupported (without crashing)")
+TEST_CASE("check that variable length lists are read with row offsets")
 {
     auto variable_length_test = [](const std::string & filepath)
     {
@@ -250,17 +250,1605 @@ TEST_CASE("check that variable length lists are unsupported (without crashing)")
         bool header_result = file.parse_header(filestream);
         REQUIRE(header_result);
 
-        std::shared_ptr<PlyData> faces;
-        try { faces = file.request_properties_from_element("face", { "vertex_indices" }, 0); }
-        catch (const std::exception& e) { std::cerr << "tinyply exception: " << e.what() << std::endl; }
-
-        CHECK_THROWS_AS(file.read(filestream), std::runtime_error);
+        std::shared_ptr<PlyData> faces = file.request_properties_from_element("face", { "vertex_indices" }, 0);
+        CHECK_NOTHROW(file.read(filestream));
+        REQUIRE(faces->offsetStride != 0);
+        CHECK(faces->list_offset(faces->count) * type_stride(faces->t) == faces->buffer.size_bytes());
     };
 
     variable_length_test("../assets/validate/valid/tet.ascii.variable-length.ply");
     variable_length_test("../assets/validate/valid/kcrane.city.ply");
 }
 
+TEST_CASE("type traits agree with the header names and strides")
+{
+    static_assert(type_stride(Type::FLOAT64) == sizeof(TypeTraits<Type::FLOAT64>::type), "type_stride must be constexpr");
+    CHECK(type_stride(Type::INT8) == sizeof(TypeTraits<Type::INT8>::type));
+    CHECK(type_stride(Type::UINT16) == sizeof(TypeTraits<Type::UINT16>::type));
+    CHECK(type_stride(Type::UINT32) == sizeof(TypeTraits<Type::UINT32>::type));
+    CHECK(type_stride(Type::FLOAT32) == sizeof(TypeTraits<Type::FLOAT32>::type));
+    CHECK(type_stride(Type::INVALID) == 0);
+    CHECK(std::string(type_name(Type::UINT8)) == "uchar");
+    CHECK(std::string(type_name(Type::FLOAT64)) == "double");
+}
+
+TEST_CASE("reading from a memory span matches reading from a stream")
+{
+    const std::vector<uint8_t> bytes = read_file_binary("../assets/icosahedron.ply");
+
+    PlyFile stream_file;
+    memory_stream ms((char*)bytes.data(), bytes.size());
+    REQUIRE(stream_file.parse_header(ms));
+    auto stream_vertices = stream_file.request_properties_from_element("vertex", { "x", "y", "z" });
+    auto stream_faces = stream_file.request_properties_from_element("face", { "vertex_indices" }, 3);
+    stream_file.read(ms);
+
+    PlyFile span_file;
+    REQUIRE(span_file.parse_header(bytes.data(), bytes.size()));
+    auto span_vertices = span_file.request_properties_from_element("vertex", { "x", "y", "z", "nx", "ny", "nz" });
+    auto span_faces = span_file.request_properties_from_element("face", { "vertex_indices" }, 3);
+    span_file.read(bytes.data(), bytes.size());
+
+    // A group covering the whole element is served in place without a copy
+    REQUIRE(span_vertices->buffer.get_const() >= bytes.data());
+    REQUIRE(span_vertices->buffer.get_const() + span_vertices->buffer.size_bytes() <= bytes.data() + bytes.size());
+
+    REQUIRE(span_faces->buffer.size_bytes() == stream_faces->buffer.size_bytes());
+    CHECK(std::memcmp(span_faces->buffer.get_const(), stream_faces->buffer.get_const(), span_faces->buffer.size_bytes()) == 0);
+    for (size_t i = 0; i < span_vertices->count; ++i)
+    {
+        CHECK(std::memcmp(span_vertices->buffer.get_const() + i * 24, stream_vertices->buffer.get_const() + i * 12, 12) == 0);
+    }
+
+    // Truncated payloads are caught by the bounds checks
+    PlyFile truncated_file;
+    REQUIRE(truncated_file.parse_header(bytes.data(), bytes.size()));
+    truncated_file.request_properties_from_element("face", { "vertex_indices" }, 3);
+    CHECK_THROWS_AS(truncated_file.read(bytes.data(), bytes.size() - 4), std::runtime_error);
+}
+
+TEST_CASE("memory-mapped reads match stream reads and outlive the PlyFile")
+{
+    std::ifstream filestream("../assets/elephant.ply", std::ios::binary);
+    PlyFile stream_file;
+    REQUIRE(stream_file.parse_header(filestream));
+    auto stream_vertices = stream_file.request_properties_from_element("vertex", { "x", "y", "z" });
+    stream_file.read(filestream);
+
+    std::shared_ptr<PlyData> mapped_vertices;
+    {
+        PlyFile mapped_file;
+        REQUIRE(mapped_file.open_mapped("../assets/elephant.ply"));
+        mapped_vertices = mapped_file.request_properties_from_element("vertex", { "x", "y", "z" });
+        mapped_file.read();
+    }
+
+    REQUIRE(mapped_vertices->buffer.size_bytes() == stream_vertices->buffer.size_bytes());
+    CHECK(std::memcmp(mapped_vertices->buffer.get_const(), stream_vertices->buffer.get_const(), stream_vertices->buffer.size_bytes()) == 0);
+
+    PlyFile missing_file;
+    CHECK_THROWS_AS(missing_file.open_mapped("../assets/does-not-exist.ply"), std::runtime_error);
+}
+
+TEST_CASE("decoding a subset of properties matches decoding all of them")
+{
+    std::ifstream full_stream("../assets/sofa.ply", std::ios::binary);
+    PlyFile full_file;
+    REQUIRE(full_file.parse_header(full_stream));
+    auto positions = full_file.request_properties_from_element("vertex", { "x", "y", "z" });
+    auto colors = full_file.request_properties_from_element("vertex", { "red", "green", "blue", "alpha" });
+    full_file.read(full_stream);
+
+    std::ifstream subset_stream("../assets/sofa.ply", std::ios::binary);
+    PlyFile subset_file;
+    REQUIRE(subset_file.parse_header(subset_stream));
+    auto xz = subset_file.request_properties_from_element("vertex", { "x", "z" });
+    auto green = subset_file.request_properties_from_element("vertex", { "green" });
+    subset_file.read(subset_stream);
+
+    REQUIRE(xz->buffer.size_bytes() == xz->count * 8);
+    REQUIRE(green->buffer.size_bytes() == green->count);
+    const float * p = reinterpret_cast<const float *>(positions->buffer.get_const());
+    const float * q = reinterpret_cast<const float *>(xz->buffer.get_const());
+    for (size_t i = 0; i < positions->count; ++i)
+    {
+        CHECK(p[i * 3 + 0] == q[i * 2 + 0]);
+        CHECK(p[i * 3 + 2] == q[i * 2 + 1]);
+        CHECK(colors->buffer.get_const()[i * 4 + 1] == green->buffer.get_const()[i]);
+    }
+}
+
+TEST_CASE("element byte offsets are computed from the header and reading stops after the last requested element")
+{
+    std::ifstream filestream("../assets/sofa.ply", std::ios::binary);
+    PlyFile file;
+    REQUIRE(file.parse_header(filestream));
+    const int64_t header_size = filestream.tellg();
+
+    const std::vector<int64_t> offsets = file.get_element_offsets();
+    REQUIRE(offsets.size() == 2);
+    CHECK(offsets[0] == header_size);
+    CHECK(offsets[1] == header_size + 12103 * 16); // float x, y, z + uchar rgba
+
+    auto vertices = file.request_properties_from_element("vertex", { "x", "y", "z" });
+    file.read(filestream);
+    CHECK(filestream.tellg() == offsets[1]);
+
+    // The first element with lists can still be located from the header
+    std::ifstream elephant_stream("../assets/elephant.ply", std::ios::binary);
+    PlyFile elephant;
+    REQUIRE(elephant.parse_header(elephant_stream));
+    CHECK(elephant.get_element_offsets()[1] == elephant.get_element_offsets()[0] + 19753 * 12);
+}
+
+// A stream that can only be read front to back, like a pipe or socket
+struct forward_only_buffer : public std::streambuf
+{
+    forward_only_buffer(const std::vector<uint8_t> & bytes)
+    {
+        char * begin = (char*)bytes.data();
+        setg(begin, begin, begin + bytes.size());
+    }
+};
+
+TEST_CASE("list-free elements are skipped or read in blocks that split the element between rows")
+{
+    // 21-byte rows, so the 4 MiB blocks hold a whole number of rows and the element needs two of them
+    const size_t skipped_rows = 1000, vertex_rows = 300000;
+    std::string header = "ply\nformat binary_little_endian 1.0\n"
+        "element skipped " + std::to_string(skipped_rows) + "\nproperty int a\nproperty float b\n"
+        "element vertex " + std::to_string(vertex_rows) + "\nproperty float x\nproperty float y\nproperty float z\n"
+        "property uchar red\nproperty double w\nelement tail 1\nproperty int t\nend_header\n";
+    std::vector<uint8_t> bytes(header.begin(), header.end());
+    auto append = [&bytes](const void * value, const size_t size)
+    {
+        bytes.insert(bytes.end(), (const uint8_t *)value, (const uint8_t *)value + size);
+    };
+    for (size_t i = 0; i < skipped_rows; ++i)
+    {
+        const int32_t a = -1;
+        const float b = -1.f;
+        append(&a, 4);
+        append(&b, 4);
+    }
+    for (size_t i = 0; i < vertex_rows; ++i)
+    {
+        const float xyz[3] = { float(i) * 0.5f, -float(i), float(i % 977) };
+        const uint8_t red = uint8_t(i * 7);
+        const double w = double(i) * 0.25;
+        append(xyz, 12);
+        append(&red, 1);
+        append(&w, 8);
+    }
+    const int32_t tail = 0x12345678;
+    append(&tail, 4);
+
+    forward_only_buffer buffer(bytes);
+    std::istream forward_stream(&buffer);
+    PlyFile file;
+    REQUIRE(file.parse_header(forward_stream));
+    auto positions = file.request_properties_from_element("vertex", { "x", "y", "z" });
+    auto reds = file.request_properties_from_element("vertex", { "red" });
+    auto weights = file.request_properties_from_element("vertex", { "w" });
+    auto tails = file.request_properties_from_element("tail", { "t" });
+    file.read(forward_stream);
+
+    REQUIRE(positions->count == vertex_rows);
+    REQUIRE(reds->count == vertex_rows);
+    REQUIRE(weights->count == vertex_rows);
+    const float * p = reinterpret_cast<const float *>(positions->buffer.get_const());
+    const double * w = reinterpret_cast<const double *>(weights->buffer.get_const());
+    size_t mismatched_rows = 0;
+    for (size_t i = 0; i < vertex_rows; ++i)
+    {
+        const bool match = p[i * 3 + 0] == float(i) * 0.5f && p[i * 3 + 1] == -float(i) && p[i * 3 + 2] == float(i % 977) &&
+            reds->buffer.get_const()[i] == uint8_t(i * 7) && w[i] == double(i) * 0.25;
+        if (!match) ++mismatched_rows;
+    }
+    CHECK(mismatched_rows == 0);
+
+    // Reading resumes exactly where the last block ended
+    REQUIRE(tails->count == 1);
+    CHECK(*reinterpret_cast<const int32_t *>(tails->buffer.get_const()) == tail);
+    CHECK(forward_stream.peek() == std::char_traits<char>::eof());
+}
+
+TEST_CASE("a sidecar index is written on first read and replaces the counting pass afterwards")
+{
+    const std::vector<uint8_t> bytes = read_file_binary("../assets/sofa.ply");
+    const std::string path = "sofa-sidecar-test.ply";
+    {
+        std::ofstream copy(path, std::ios::binary);
+        copy.write((const char*)bytes.data(), bytes.size());
+    }
+    std::remove((path + ".idx").c_str());
+
+    std::shared_ptr<PlyData> first_faces, second_faces;
+    {
+        std::ifstream filestream(path, std::ios::binary);
+        PlyFile file;
+        REQUIRE(file.parse_header(filestream));
+        CHECK_FALSE(file.use_sidecar_index(path));
+        first_faces = file.request_properties_from_element("face", { "texcoord" });
+        file.read(filestream);
+    }
+
+    // With the index, a non-seekable stream is sized exactly up front
+    forward_only_buffer buffer(bytes);
+    std::istream forward_stream(&buffer);
+    PlyFile file;
+    REQUIRE(file.parse_header(forward_stream));
+    REQUIRE(file.use_sidecar_index(path));
+    CHECK(file.get_element_offsets()[1] > 0);
+    second_faces = file.request_properties_from_element("face", { "texcoord" });
+    file.read(forward_stream);
+
+    REQUIRE(second_faces->buffer.size_bytes() == first_faces->buffer.size_bytes());
+    CHECK(std::memcmp(second_faces->buffer.get_const(), first_faces->buffer.get_const(), first_faces->buffer.size_bytes()) == 0);
+    CHECK(file.get_elements()[1].properties[1].listCount == 6);
+
+    std::remove((path + ".idx").c_str());
+    std::remove(path.c_str());
+}
+
+TEST_CASE("parallel ascii reads match serial reads")
+{
+    std::vector<uint8_t> bytes = read_file_binary("../assets/sofa_ascii.ply");
+
+    auto read_vertices = [](std::vector<uint8_t> & data, const size_t thread_count)
+    {
+        PlyFile file;
+        REQUIRE(file.parse_header(data.data(), data.size()));
+        auto vertices = file.request_properties_from_element("vertex", { "x", "y", "z" });
+        auto faces = file.request_properties_from_element("face", { "vertex_indices" }, 3);
+        if (thread_count) file.read_parallel(data.data(), data.size(), thread_count);
+        else file.read(data.data(), data.size());
+        return std::make_pair(vertices, faces);
+    };
+
+    auto serial = read_vertices(bytes, 0);
+    auto parallel = read_vertices(bytes, 4);
+    REQUIRE(parallel.first->buffer.size_bytes() == serial.first->buffer.size_bytes());
+    CHECK(std::memcmp(parallel.first->buffer.get_const(), serial.first->buffer.get_const(), serial.first->buffer.size_bytes()) == 0);
+    CHECK(std::memcmp(parallel.second->buffer.get_const(), serial.second->buffer.get_const(), serial.second->buffer.size_bytes()) == 0);
+
+    // A row wrapped over two lines cannot be delimited by newlines; the element is parsed serially
+    const std::string header_end = "end_header\n";
+    auto it = std::search(bytes.begin(), bytes.end(), header_end.begin(), header_end.end()) + header_end.size();
+    it = std::find(std::find(it, bytes.end(), ' ') + 1, bytes.end(), ' ');
+    *it = '\n';
+    auto wrapped = read_vertices(bytes, 4);
+    CHECK(std::memcmp(wrapped.first->buffer.get_const(), serial.first->buffer.get_const(), serial.first->buffer.size_bytes()) == 0);
+
+    // An empty element has no rows to split, from memory or from a stream
+    const std::string empty = "ply\nformat ascii 1.0\nelement vertex 0\nproperty float x\nelement face 1\nproperty list uchar int vertex_indices\nend_header\n3 0 1 2\n";
+    for (const bool from_memory : { true, false })
+    {
+        std::istringstream is(empty);
+        PlyFile file;
+        if (from_memory) REQUIRE(file.parse_header(reinterpret_cast<const uint8_t *>(empty.data()), empty.size()));
+        else REQUIRE(file.parse_header(is));
+        auto x = file.request_properties_from_element("vertex", { "x" });
+        auto faces = file.request_properties_from_element("face", { "vertex_indices" });
+        if (from_memory) file.read_parallel(reinterpret_cast<const uint8_t *>(empty.data()), empty.size(), 2);
+        else file.read_parallel(is, 2);
+        CHECK(x->count == 0);
+        CHECK(x->buffer.size_bytes() == 0);
+        REQUIRE(faces->buffer.size_bytes() == 3 * sizeof(int32_t));
+        CHECK(reinterpret_cast<const int32_t *>(faces->buffer.get_const())[2] == 2);
+    }
+}
+
+TEST_CASE("ascii values are parsed exactly and malformed values are rejected")
+{
+    const std::string header = "ply\nformat ascii 1.0\nelement vertex 3\nproperty float x\nproperty double y\nproperty uchar c\nproperty int i\nend_header\n";
+    const std::string payload = "0.1 1e-300 255 -7\n-2.5E+3 0.30000000000000004 -1 +42\ninf nan 7 1.75\n";
+
+    std::istringstream stream(header + payload);
+    PlyFile file;
+    REQUIRE(file.parse_header(stream));
+    auto x = file.request_properties_from_element("vertex", { "x" });
+    auto y = file.request_properties_from_element("vertex", { "y" });
+    auto c = file.request_properties_from_element("vertex", { "c" });
+    auto i = file.request_properties_from_element("vertex", { "i" });
+    file.read(stream);
+
+    const float * xs = reinterpret_cast<const float *>(x->buffer.get_const());
+    const double * ys = reinterpret_cast<const double *>(y->buffer.get_const());
+    const uint8_t * cs = c->buffer.get_const();
+    const int32_t * is = reinterpret_cast<const int32_t *>(i->buffer.get_const());
+    CHECK(xs[0] == 0.1f);
+    CHECK(xs[1] == -2500.0f);
+    CHECK(xs[2] == std::numeric_limits<float>::infinity());
+    CHECK(ys[0] == 1e-300);
+    CHECK(ys[1] == 0.30000000000000004);
+    CHECK(ys[2] != ys[2]);
+    CHECK(cs[0] == 255);
+    CHECK(cs[1] == 255);
+    CHECK(is[0] == -7);
+    CHECK(is[1] == 42);
+    CHECK(is[2] == 1);
+
+    std::istringstream malformed(header + "0.1 0.2 1 2\n0.1 zero 1 2\n0 0 0 0\n");
+    PlyFile bad;
+    REQUIRE(bad.parse_header(malformed));
+    bad.request_properties_from_element("vertex", { "y" });
+    CHECK_THROWS_AS(bad.read(malformed), std::runtime_error);
+}
+
+TEST_CASE("ascii writes round-trip floats exactly, or to a fixed precision")
+{
+    std::vector<float> floats = { 0.1f, -2.5f, 1e-45f, 3.4028235e38f, 16777216.0f, 0.0378297f, 0.0f };
+    std::vector<double> doubles = { 0.1, 5e-324, 1.7976931348623157e308, -1e21, 123456.789, 0.30000000000000004, -0.0 };
+    std::vector<int32_t> ints = { 0, -1, 2147483647, -2147483647 - 1, 42, -100000, 7 };
+
+    auto write_ascii = [&](const int decimals)
+    {
+        PlyFile file;
+        file.set_ascii_precision(decimals);
+        file.add_properties_to_element("vertex", { "x" }, Type::FLOAT32, floats.size(), reinterpret_cast<uint8_t *>(floats.data()), Type::INVALID, 0);
+        file.add_properties_to_element("vertex", { "y" }, Type::FLOAT64, doubles.size(), reinterpret_cast<uint8_t *>(doubles.data()), Type::INVALID, 0);
+        file.add_properties_to_element("vertex", { "i" }, Type::INT32, ints.size(), reinterpret_cast<uint8_t *>(ints.data()), Type::INVALID, 0);
+        std::ostringstream os;
+        file.write(os, false);
+        return os.str();
+    };
+
+    std::istringstream shortest(write_ascii(-1));
+    PlyFile file;
+    REQUIRE(file.parse_header(shortest));
+    auto x = file.request_properties_from_element("vertex", { "x" });
+    auto y = file.request_properties_from_element("vertex", { "y" });
+    auto i = file.request_properties_from_element("vertex", { "i" });
+    file.read(shortest);
+    CHECK(std::memcmp(x->buffer.get_const(), floats.data(), floats.size() * sizeof(float)) == 0);
+    CHECK(std::memcmp(y->buffer.get_const(), doubles.data(), doubles.size() * sizeof(double)) == 0);
+    CHECK(std::memcmp(i->buffer.get_const(), ints.data(), ints.size() * sizeof(int32_t)) == 0);
+
+    floats.resize(2);
+    doubles.resize(2);
+    ints.resize(2);
+    const std::string fixed = write_ascii(3);
+    CHECK(fixed.substr(fixed.find("end_header\n") + 11) == "0.100 0.100 0 \n-2.500 0.000 -1 \n");
+
+    CHECK_THROWS_AS(file.set_ascii_precision(18), std::invalid_argument);
+}
+
+TEST_CASE("big-endian files are byte-swapped for every value width")
+{
+    // 100 vertices of (short, uint, double) and 100 faces of uint lists, written big-endian byte by byte
+    std::string ply = "ply\nformat binary_big_endian 1.0\nelement vertex 100\nproperty short s\nproperty uint u\nproperty double d\n"
+                      "element face 100\nproperty list uchar uint vertex_indices\nend_header\n";
+    auto put_be = [&](uint64_t v, const int width) { for (int b = width - 1; b >= 0; --b) ply.push_back(static_cast<char>((v >> (8 * b)) & 0xFF)); };
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        const double d = i * 0.5 - 7.25;
+        uint64_t d_bits;
+        std::memcpy(&d_bits, &d, sizeof(d));
+        put_be(static_cast<uint16_t>(-static_cast<int16_t>(i) * 300), 2);
+        put_be(0x01020304u * i, 4);
+        put_be(d_bits, 8);
+    }
+    for (uint32_t i = 0; i < 100; ++i) { put_be(3, 1); put_be(i, 4); put_be(i + 1, 4); put_be(0xA0B0C0D0u + i, 4); }
+
+    for (const bool span : { false, true })
+    {
+        std::istringstream stream(ply);
+        PlyFile file;
+        if (span) REQUIRE(file.parse_header(reinterpret_cast<const uint8_t *>(ply.data()), ply.size()));
+        else REQUIRE(file.parse_header(stream));
+        auto s = file.request_properties_from_element("vertex", { "s" });
+        auto u = file.request_properties_from_element("vertex", { "u" });
+        auto d = file.request_properties_from_element("vertex", { "d" });
+        std::vector<uint32_t> indices(300);
+        auto faces = span ? file.request_properties_from_element("face", { "vertex_indices" }, reinterpret_cast<uint8_t *>(indices.data()), indices.size() * sizeof(uint32_t))
+                          : file.request_properties_from_element("face", { "vertex_indices" }, 3);
+        if (span) file.read(reinterpret_cast<const uint8_t *>(ply.data()), ply.size());
+        else file.read(stream);
+
+        const int16_t * ss = reinterpret_cast<const int16_t *>(s->buffer.get_const());
+        const uint32_t * us = reinterpret_cast<const uint32_t *>(u->buffer.get_const());
+        const double * ds = reinterpret_cast<const double *>(d->buffer.get_const());
+        const uint32_t * fs = reinterpret_cast<const uint32_t *>(faces->buffer.get_const());
+        bool all_equal = true;
+        for (uint32_t i = 0; i < 100; ++i)
+        {
+            all_equal &= ss[i] == static_cast<int16_t>(-static_cast<int16_t>(i) * 300);
+            all_equal &= us[i] == 0x01020304u * i;
+            all_equal &= ds[i] == i * 0.5 - 7.25;
+            all_equal &= fs[i * 3] == i && fs[i * 3 + 1] == i + 1 && fs[i * 3 + 2] == 0xA0B0C0D0u + i;
+        }
+        CHECK(all_equal);
+    }
+}
+
+TEST_CASE("properties can be read straight into caller memory, interleaved or packed")
+{
+    struct Vertex { float position[3]; uint8_t color[4]; double unused; };
+
+    // The ascii sofa has no colors
+    for (const std::string path : { "../assets/sofa.ply", "../assets/sofa_ascii.ply" })
+    {
+        std::vector<uint8_t> bytes = read_file_binary(path);
+        const bool has_colors = path == "../assets/sofa.ply";
+
+        PlyFile reference;
+        REQUIRE(reference.parse_header(bytes.data(), bytes.size()));
+        auto positions = reference.request_properties_from_element("vertex", { "x", "y", "z" });
+        std::shared_ptr<PlyData> colors;
+        if (has_colors) colors = reference.request_properties_from_element("vertex", { "red", "green", "blue", "alpha" });
+        auto faces = reference.request_properties_from_element("face", { "vertex_indices" });
+        reference.read(bytes.data(), bytes.size());
+
+        const PlyView<const float> xyz = static_cast<const PlyData &>(*positions).view<float>();
+        REQUIRE(xyz.size() == positions->count * 3);
+        CHECK(positions->view<float3>()[1].y == xyz[4]);
+        CHECK_THROWS_AS(positions->view<double>(), std::invalid_argument);
+        CHECK_THROWS_AS(positions->view<Vertex>(), std::invalid_argument);
+
+        for (const size_t thread_count : { 0, 4 })
+        {
+            std::vector<Vertex> vertices(positions->count);
+            std::vector<uint32_t> indices(faces->buffer.size_bytes() / sizeof(uint32_t));
+
+            PlyFile file;
+            REQUIRE(file.parse_header(bytes.data(), bytes.size()));
+            file.request_properties_from_element("vertex", { "x", "y", "z" }, reinterpret_cast<uint8_t *>(&vertices[0].position), vertices.size() * sizeof(Vertex), sizeof(Vertex));
+            if (has_colors) file.request_properties_from_element("vertex", { "red", "green", "blue", "alpha" }, vertices[0].color, vertices.size() * sizeof(Vertex) - offsetof(Vertex, color), sizeof(Vertex));
+            auto packed = file.request_properties_from_element("face", { "vertex_indices" }, reinterpret_cast<uint8_t *>(indices.data()), indices.size() * sizeof(uint32_t));
+            CHECK_THROWS_AS(file.request_properties_from_element("face", { "texcoord" }, reinterpret_cast<uint8_t *>(indices.data()), indices.size() * sizeof(uint32_t), 64), std::invalid_argument);
+            if (thread_count) file.read_parallel(bytes.data(), bytes.size(), thread_count);
+            else file.read(bytes.data(), bytes.size());
+
+            bool all_equal = true;
+            for (size_t i = 0; i < vertices.size(); ++i)
+            {
+                all_equal &= std::memcmp(vertices[i].position, &xyz[i * 3], sizeof(vertices[i].position)) == 0;
+                if (has_colors) all_equal &= std::memcmp(vertices[i].color, colors->buffer.get_const() + i * 4, 4) == 0;
+            }
+            CHECK(all_equal);
+            CHECK(packed->buffer.get_const() == reinterpret_cast<const uint8_t *>(indices.data()));
+            CHECK(std::memcmp(indices.data(), faces->buffer.get_const(), faces->buffer.size_bytes()) == 0);
+        }
+    }
+
+    std::vector<float> too_small(10);
+    PlyFile file;
+    std::ifstream filestream("../assets/sofa.ply", std::ios::binary);
+    REQUIRE(file.parse_header(filestream));
+    CHECK_THROWS_AS(file.request_properties_from_element("vertex", { "x", "y", "z" }, reinterpret_cast<uint8_t *>(too_small.data()), too_small.size() * sizeof(float)), std::invalid_argument);
+}
+
+TEST_CASE("properties are converted to a requested type as they are read")
+{
+    // Vertices of mixed types, a densely packed element of doubles and faces of int lists; written
+    // as ascii and in both byte orders
+    const std::string header = "element vertex 100\nproperty double x\nproperty float y\nproperty int z\nproperty uchar r\nproperty float w\n"
+                               "element sample 37\nproperty double value\nelement face 50\nproperty list uchar int vertex_indices\nend_header\n";
+    auto w_of = [](uint32_t i) { return i % 4 == 0 ? 1e9f : i % 4 == 1 ? -1e9f : i % 4 == 2 ? std::numeric_limits<float>::quiet_NaN() : i - 0.75f; };
+
+    std::vector<std::string> files;
+    for (const int format : { 0, 1, 2 })
+    {
+        std::ostringstream ply;
+        ply << "ply\nformat " << (format == 0 ? "ascii" : format == 1 ? "binary_little_endian" : "binary_big_endian") << " 1.0\n" << header;
+        ply << std::setprecision(17);
+        auto put = [&](const void * v, const int width)
+        {
+            for (int b = 0; b < width; ++b) ply.put(reinterpret_cast<const char *>(v)[format == 2 ? width - 1 - b : b]);
+        };
+        for (uint32_t i = 0; i < 100; ++i)
+        {
+            const double x = i * 0.25 - 3; const float y = i * 1.5f; const int32_t z = static_cast<int32_t>(i) - 50;
+            const uint8_t r = static_cast<uint8_t>(i * 2); const float w = w_of(i);
+            if (format == 0)
+            {
+                ply << x << " " << y << " " << z << " " << int(r) << " ";
+                if (w == w) ply << w << "\n";
+                else ply << "nan\n";
+            }
+            else { put(&x, 8); put(&y, 4); put(&z, 4); put(&r, 1); put(&w, 4); }
+        }
+        for (uint32_t j = 0; j < 37; ++j)
+        {
+            const double value = j * 1.1;
+            if (format == 0) ply << value << "\n";
+            else put(&value, 8);
+        }
+        for (int32_t i = 0; i < 50; ++i)
+        {
+            const uint8_t n = 3; const int32_t a = i, b = i + 1, c = -1;
+            if (format == 0) ply << "3 " << a << " " << b << " " << c << "\n";
+            else { put(&n, 1); put(&a, 4); put(&b, 4); put(&c, 4); }
+        }
+        files.push_back(ply.str());
+    }
+
+    for (const std::string & ply : files)
+    {
+        for (const int mode : { 0, 1, 2 })
+        {
+            struct Position { float x, y, z, pad; };
+            std::vector<Position> interleaved(100);
+
+            std::istringstream stream(ply);
+            PlyFile file;
+            if (mode == 0) REQUIRE(file.parse_header(stream));
+            else REQUIRE(file.parse_header(reinterpret_cast<const uint8_t *>(ply.data()), ply.size()));
+            CHECK_THROWS_AS(file.request_properties_from_element("vertex", { "x", "y" }), std::invalid_argument);
+            auto xyz = file.request_properties_from_element("vertex", { "x", "y", "z" }, Type::FLOAT32);
+            file.request_properties_from_element("vertex", { "r" }, reinterpret_cast<uint8_t *>(&interleaved[0].pad), interleaved.size() * sizeof(Position) - offsetof(Position, pad), sizeof(Position), Type::FLOAT32);
+            auto w = file.request_properties_from_element("vertex", { "w" }, Type::INT16);
+            auto value = file.request_properties_from_element("sample", { "value" }, Type::FLOAT32);
+            auto faces = file.request_properties_from_element("face", { "vertex_indices" }, Type::UINT16, mode == 1 ? 3 : 0);
+            if (mode == 0) file.read(stream);
+            else if (mode == 1) file.read(reinterpret_cast<const uint8_t *>(ply.data()), ply.size());
+            else file.read_parallel(reinterpret_cast<const uint8_t *>(ply.data()), ply.size(), 4);
+
+            REQUIRE(xyz->t == Type::FLOAT32);
+            REQUIRE(faces->t == Type::UINT16);
+            REQUIRE(xyz->buffer.size_bytes() == 100 * 3 * sizeof(float));
+            REQUIRE(faces->buffer.size_bytes() == 50 * 3 * sizeof(uint16_t));
+            const PlyView<float3> positions = xyz->view<float3>();
+            const PlyView<int16_t> ws = w->view<int16_t>();
+            const PlyView<float> values = value->view<float>();
+            const PlyView<uint16_t> indices = faces->view<uint16_t>();
+
+            bool all_equal = true;
+            for (uint32_t i = 0; i < 100; ++i)
+            {
+                all_equal &= positions[i].x == static_cast<float>(i * 0.25 - 3) && positions[i].y == i * 1.5f && positions[i].z == static_cast<float>(static_cast<int32_t>(i) - 50);
+                all_equal &= interleaved[i].pad == static_cast<float>(static_cast<uint8_t>(i * 2));
+                all_equal &= ws[i] == (i % 4 == 0 ? 32767 : i % 4 == 1 ? -32768 : i % 4 == 2 ? 0 : static_cast<int16_t>(i - 1));
+            }
+            for (uint32_t j = 0; j < 37; ++j) all_equal &= values[j] == static_cast<float>(j * 1.1);
+            for (uint16_t i = 0; i < 50; ++i) all_equal &= indices[i * 3] == i && indices[i * 3 + 1] == i + 1 && indices[i * 3 + 2] == 65535;
+            CHECK(all_equal);
+        }
+    }
+}
+
+TEST_CASE("doubles beyond the range of float convert to its largest value or infinity")
+{
+    const double max = std::numeric_limits<float>::max();
+    const double values[] = { 1e300, -1e300, max + std::ldexp(1.0, 102), 3.0, 1e300, -(max + std::ldexp(1.0, 103)) };
+    const float inf = std::numeric_limits<float>::infinity();
+    const float expected[] = { inf, -inf, std::numeric_limits<float>::max(), 3.0f, inf, -inf };
+
+    // Little-endian runs take the vector kernel and its scalar tail, big-endian ones the swapping loop
+    for (const bool big_endian : { false, true })
+    {
+        std::string ply = std::string("ply\nformat ") + (big_endian ? "binary_big_endian" : "binary_little_endian") + " 1.0\nelement sample 6\nproperty double value\nend_header\n";
+        for (const double v : values)
+        {
+            char bytes[8];
+            std::memcpy(bytes, &v, 8);
+            if (big_endian) std::reverse(bytes, bytes + 8);
+            ply.append(bytes, 8);
+        }
+        PlyFile file;
+        REQUIRE(file.parse_header(reinterpret_cast<const uint8_t *>(ply.data()), ply.size()));
+        auto samples = file.request_properties_from_element("sample", { "value" }, Type::FLOAT32);
+        file.read(reinterpret_cast<const uint8_t *>(ply.data()), ply.size());
+        const PlyView<float> converted = samples->view<float>();
+        REQUIRE(converted.size() == 6);
+        for (size_t i = 0; i < 6; ++i) CHECK(converted[i] == expected[i]);
+    }
+}
+
+TEST_CASE("streamed chunks concatenate to what a whole read returns")
+{
+    for (const std::string path : { "../assets/sofa.ply", "../assets/sofa_ascii.ply" })
+    {
+        std::vector<uint8_t> bytes = read_file_binary(path);
+
+        PlyFile reference;
+        REQUIRE(reference.parse_header(bytes.data(), bytes.size()));
+        auto ref_positions = reference.request_properties_from_element("vertex", { "x", "y", "z" });
+        auto ref_faces = reference.request_properties_from_element("face", { "vertex_indices" });
+        reference.read(bytes.data(), bytes.size());
+        const std::vector<uint8_t> expected_positions(ref_positions->buffer.get_const(), ref_positions->buffer.get_const() + ref_positions->buffer.size_bytes());
+        const std::vector<uint8_t> expected_faces(ref_faces->buffer.get_const(), ref_faces->buffer.get_const() + ref_faces->buffer.size_bytes());
+
+        for (const bool span : { false, true })
+        {
+            for (const uint32_t hint : { 0, 3 })
+            {
+                std::string str(bytes.begin(), bytes.end());
+                std::istringstream is(str);
+                PlyFile file;
+                if (span) REQUIRE(file.parse_header(bytes.data(), bytes.size()));
+                else REQUIRE(file.parse_header(is));
+                auto positions = file.request_properties_from_element("vertex", { "x", "y", "z" });
+                auto faces = file.request_properties_from_element("face", { "vertex_indices" }, hint);
+                PlyStream stream = span ? file.begin_stream(bytes.data(), bytes.size()) : file.begin_stream(is);
+
+                std::vector<uint8_t> streamed_positions, streamed_faces;
+                std::string element;
+                size_t next_row = 0;
+                while (const size_t rows = stream.next_chunk(1000))
+                {
+                    CHECK(rows <= 1000);
+                    if (stream.element() != element) next_row = 0;
+                    element = stream.element();
+                    CHECK(stream.first_row() == next_row);
+                    next_row += rows;
+
+                    std::shared_ptr<PlyData> data = element == "vertex" ? positions : faces;
+                    CHECK(data->count == rows);
+                    std::vector<uint8_t> & out = element == "vertex" ? streamed_positions : streamed_faces;
+                    out.insert(out.end(), data->buffer.get_const(), data->buffer.get_const() + data->buffer.size_bytes());
+                }
+                CHECK(element == "face");
+                CHECK(stream.next_chunk(1000) == 0);
+                CHECK(streamed_positions == expected_positions);
+                CHECK(streamed_faces == expected_faces);
+            }
+        }
+    }
+}
+
+TEST_CASE("a visitor receives every requested element in batches and can stop early")
+{
+    struct Visitor : PlyVisitor
+    {
+        std::vector<float> xyz;
+        std::vector<uint8_t> colors;
+        size_t face_batches{ 0 };
+        bool stop_at_faces{ false };
+
+        bool on_element_batch(const PlyElement & element, const std::vector<std::shared_ptr<PlyData>> & columns, const size_t row_begin, const size_t row_count) override
+        {
+            if (element.name == "face")
+            {
+                ++face_batches;
+                return !stop_at_faces;
+            }
+            CHECK(columns.size() == 2);
+            CHECK(row_begin * 3 == xyz.size());
+            CHECK(columns[0]->count == row_count);
+            const PlyView<float> positions = columns[0]->view<float>();
+            xyz.insert(xyz.end(), positions.begin(), positions.end());
+            colors.insert(colors.end(), columns[1]->buffer.get_const(), columns[1]->buffer.get_const() + columns[1]->buffer.size_bytes());
+            return true;
+        }
+    };
+
+    std::vector<uint8_t> bytes = read_file_binary("../assets/sofa.ply");
+    PlyFile reference;
+    REQUIRE(reference.parse_header(bytes.data(), bytes.size()));
+    auto positions = reference.request_properties_from_element("vertex", { "x", "y", "z" });
+    auto colors = reference.request_properties_from_element("vertex", { "red", "green", "blue", "alpha" });
+    reference.read(bytes.data(), bytes.size());
+
+    for (const bool stop_at_faces : { false, true })
+    {
+        PlyFile file;
+        REQUIRE(file.parse_header(bytes.data(), bytes.size()));
+        file.request_properties_from_element("vertex", { "red", "green", "blue", "alpha" });
+        file.request_properties_from_element("vertex", { "x", "y", "z" });
+        file.request_properties_from_element("face", { "vertex_indices" }, 3);
+
+        Visitor visitor;
+        visitor.stop_at_faces = stop_at_faces;
+        CHECK(file.read(bytes.data(), bytes.size(), visitor, 500) == !stop_at_faces);
+        CHECK(visitor.xyz.size() == positions->count * 3);
+        CHECK(std::memcmp(visitor.xyz.data(), positions->buffer.get_const(), positions->buffer.size_bytes()) == 0);
+        CHECK(std::memcmp(visitor.colors.data(), colors->buffer.get_const(), colors->buffer.size_bytes()) == 0);
+        CHECK(visitor.face_batches == (stop_at_faces ? 1 : (file.get_elements()[1].size + 499) / 500));
+    }
+}
+
+TEST_CASE("variable length lists round-trip through row offsets")
+{
+    // Faces of 3, 4, 0 and 5 indices, plus a per-face flag after the list
+    const std::vector<uint32_t> offsets = { 0, 3, 7, 7, 12 };
+    std::vector<int32_t> indices(12);
+    for (int32_t i = 0; i < 12; ++i) indices[i] = i * 7 - 20;
+    const std::vector<uint8_t> flags = { 1, 2, 3, 4 };
+
+    PlyFile source;
+    source.add_list_property_to_element("face", "vertex_indices", Type::INT32, 4, reinterpret_cast<const uint8_t *>(indices.data()), Type::UINT8, offsets.data());
+    source.add_properties_to_element("face", { "flag" }, Type::UINT8, 4, flags.data(), Type::INVALID, 0);
+
+    for (const bool binary : { false, true })
+    {
+        std::ostringstream os;
+        source.write(os, binary);
+        const std::string ply = os.str();
+
+        for (const int mode : { 0, 1, 2 })
+        {
+            std::istringstream is(ply);
+            PlyFile file;
+            REQUIRE(file.parse_header(is));
+            auto faces = file.request_properties_from_element("face", { "vertex_indices" }, mode == 1 ? 5 : 0);
+            auto face_flags = file.request_properties_from_element("face", { "flag" });
+
+            std::vector<int32_t> values;
+            std::vector<uint64_t> row_offsets(1, 0);
+            std::vector<uint8_t> read_flags;
+            auto collect = [&]()
+            {
+                REQUIRE(faces->offsetStride == sizeof(uint32_t));
+                for (size_t row = 0; row < faces->count; ++row) row_offsets.push_back(row_offsets.back() + faces->list_offset(row + 1) - faces->list_offset(row));
+                const PlyView<int32_t> v = faces->view<int32_t>();
+                values.insert(values.end(), v.begin(), v.begin() + faces->list_offset(faces->count));
+                read_flags.insert(read_flags.end(), face_flags->buffer.get_const(), face_flags->buffer.get_const() + face_flags->count);
+            };
+            if (mode == 2)
+            {
+                PlyStream stream = file.begin_stream(is);
+                while (stream.next_chunk(3)) collect();
+            }
+            else
+            {
+                file.read(is);
+                CHECK(file.get_elements()[0].properties[0].listCount == 0);
+                collect();
+            }
+
+            CHECK(values == indices);
+            CHECK(row_offsets == std::vector<uint64_t>(offsets.begin(), offsets.end()));
+            CHECK(read_flags == flags);
+
+            // Lists that are read back can be written out again as they are
+            if (mode == 0)
+            {
+                PlyFile copy;
+                copy.add_list_property_to_element("face", "vertex_indices", Type::INT32, faces->count, faces->buffer.get_const(), Type::UINT8, reinterpret_cast<const uint32_t *>(faces->offsets.get_const()));
+                copy.add_properties_to_element("face", { "flag" }, Type::UINT8, 4, face_flags->buffer.get_const(), Type::INVALID, 0);
+                std::ostringstream again;
+                copy.write(again, binary);
+                CHECK(again.str() == ply);
+            }
+        }
+    }
+}
+
+TEST_CASE("lists are read in a single pass from streams that cannot seek")
+{
+    // Lists of 0 to 8 values, so that buffers sized for triangles have to grow
+    std::vector<uint32_t> offsets(1, 0);
+    for (uint32_t row = 0; row < 5000; ++row) offsets.push_back(offsets.back() + (row * 7) % 9);
+    std::vector<uint16_t> values(offsets.back());
+    for (size_t i = 0; i < values.size(); ++i) values[i] = static_cast<uint16_t>(i * 31);
+
+    PlyFile source;
+    source.add_list_property_to_element("strip", "values", Type::UINT16, 5000, reinterpret_cast<const uint8_t *>(values.data()), Type::UINT8, offsets.data());
+
+    for (const bool binary : { false, true })
+    {
+        std::ostringstream os;
+        source.write(os, binary);
+        const std::string ply = os.str();
+        const std::vector<uint8_t> bytes(ply.begin(), ply.end());
+
+        for (const uint32_t hint : { 0, 2, 20 })
+        {
+            forward_only_buffer buffer(bytes);
+            std::istream is(&buffer);
+            PlyFile file;
+            REQUIRE(file.parse_header(is));
+            auto strips = file.request_properties_from_element("strip", { "values" }, hint);
+            file.read(is);
+
+            REQUIRE(strips->buffer.size_bytes() == values.size() * sizeof(uint16_t));
+            CHECK(std::memcmp(strips->buffer.get_const(), values.data(), strips->buffer.size_bytes()) == 0);
+            CHECK(std::memcmp(strips->offsets.get_const(), offsets.data(), offsets.size() * sizeof(uint32_t)) == 0);
+        }
+
+        forward_only_buffer buffer(bytes);
+        std::istream is(&buffer);
+        PlyFile file;
+        REQUIRE(file.parse_header(is));
+        auto strips = file.request_properties_from_element("strip", { "values" });
+        PlyStream stream = file.begin_stream(is);
+        std::vector<uint16_t> streamed;
+        while (stream.next_chunk(700))
+        {
+            const PlyView<uint16_t> v = strips->view<uint16_t>();
+            streamed.insert(streamed.end(), v.begin(), v.end());
+            CHECK(v.size() == strips->list_offset(strips->count));
+        }
+        CHECK(streamed == values);
+    }
+}
+
+TEST_CASE("buffers are aligned and can be allocated from an arena that is reset between files")
+{
+    auto is_aligned = [](const uint8_t * ptr) { return reinterpret_cast<uintptr_t>(ptr) % Buffer::alignment == 0; };
+
+    PlyArena scratch(256);
+    uint8_t * first = scratch.allocate(3);
+    CHECK(is_aligned(first));
+    CHECK(is_aligned(scratch.allocate(100)));
+    CHECK(is_aligned(scratch.allocate(1000))); // spills into another block
+    CHECK(scratch.bytes_used() == 64 + 128 + 1024);
+    scratch.reset();
+    CHECK(scratch.bytes_used() == 0);
+    const size_t reserved = scratch.bytes_reserved();
+    uint8_t * again = scratch.allocate(reserved); // blocks were merged into one
+    CHECK(scratch.bytes_reserved() == reserved);
+    CHECK(is_aligned(again));
+
+    std::vector<float> xyz(3 * 50);
+    for (size_t i = 0; i < xyz.size(); ++i) xyz[i] = static_cast<float>(i);
+    std::vector<uint32_t> offsets(1, 0);
+    for (uint32_t row = 0; row < 40; ++row) offsets.push_back(offsets.back() + 3 + row % 2);
+    std::vector<int32_t> indices(offsets.back());
+    for (size_t i = 0; i < indices.size(); ++i) indices[i] = static_cast<int32_t>(i % 50);
+
+    PlyFile source;
+    source.add_properties_to_element("vertex", { "x", "y", "z" }, Type::FLOAT32, 50, reinterpret_cast<const uint8_t *>(xyz.data()), Type::INVALID, 0);
+    source.add_list_property_to_element("face", "vertex_indices", Type::INT32, 40, reinterpret_cast<const uint8_t *>(indices.data()), Type::UINT8, offsets.data());
+    std::ostringstream os;
+    source.write(os, true);
+    const std::string ply = os.str();
+
+    auto arena = std::make_shared<PlyArena>(64 * 1024);
+    std::shared_ptr<PlyData> vertices, faces;
+    for (const bool with_arena : { false, true, true })
+    {
+        if (with_arena) arena->reset();
+        std::istringstream is(ply);
+        PlyFile file;
+        REQUIRE(file.parse_header(is));
+        if (with_arena) file.use_arena(arena);
+        vertices = file.request_properties_from_element("vertex", { "x", "y", "z" });
+        faces = file.request_properties_from_element("face", { "vertex_indices" });
+        file.read(is);
+
+        for (const uint8_t * ptr : { vertices->buffer.get_const(), faces->buffer.get_const(), faces->offsets.get_const() }) CHECK(is_aligned(ptr));
+        CHECK((arena->bytes_used() > 0) == with_arena);
+        CHECK(std::memcmp(vertices->buffer.get_const(), xyz.data(), xyz.size() * sizeof(float)) == 0);
+        REQUIRE(faces->buffer.size_bytes() == indices.size() * sizeof(int32_t));
+        CHECK(std::memcmp(faces->buffer.get_const(), indices.data(), faces->buffer.size_bytes()) == 0);
+    }
+    CHECK(arena->bytes_reserved() == 64 * 1024);
+}
+
+TEST_CASE("a parsed header and its requests are reused for a batch of files with the same layout")
+{
+    // Tiles differing in their counts, values and comments, but not in their layout
+    auto make_tile = [](const size_t vertex_count, const bool binary, const std::string & comment)
+    {
+        std::vector<float> xyz(3 * vertex_count);
+        for (size_t i = 0; i < xyz.size(); ++i) xyz[i] = static_cast<float>(i + vertex_count);
+        std::vector<uint32_t> offsets(1, 0);
+        for (size_t row = 0; row < vertex_count / 2; ++row) offsets.push_back(offsets.back() + 3 + row % 2);
+        std::vector<int32_t> indices(offsets.back());
+        for (size_t i = 0; i < indices.size(); ++i) indices[i] = static_cast<int32_t>(i % vertex_count);
+
+        PlyFile tile;
+        tile.get_comments().push_back(comment);
+        tile.add_properties_to_element("vertex", { "x", "y", "z" }, Type::FLOAT32, vertex_count, reinterpret_cast<const uint8_t *>(xyz.data()), Type::INVALID, 0);
+        tile.add_list_property_to_element("face", "vertex_indices", Type::INT32, offsets.size() - 1, reinterpret_cast<const uint8_t *>(indices.data()), Type::UINT8, offsets.data());
+        std::ostringstream os;
+        tile.write(os, binary);
+        return os.str();
+    };
+
+    for (const bool binary : { false, true })
+    {
+        const std::string first = make_tile(20, binary, "first");
+        std::istringstream is(first);
+        PlyFile file;
+        REQUIRE(file.parse_header(is));
+        auto vertices = file.request_properties_from_element("vertex", { "x", "y", "z" });
+        auto faces = file.request_properties_from_element("face", { "vertex_indices" });
+        file.read(is);
+        CHECK(vertices->count == 20);
+        const uint8_t * first_buffer = vertices->buffer.get_const();
+
+        for (const size_t vertex_count : { 12, 40, 0, 7 })
+        {
+            const std::string tile = make_tile(vertex_count, binary, "tile " + std::to_string(vertex_count));
+
+            PlyFile reference;
+            std::istringstream ref_stream(tile);
+            REQUIRE(reference.parse_header(ref_stream));
+            auto ref_vertices = reference.request_properties_from_element("vertex", { "x", "y", "z" });
+            auto ref_faces = reference.request_properties_from_element("face", { "vertex_indices" });
+            reference.read(ref_stream);
+
+            for (const bool span : { false, true })
+            {
+                if (span) REQUIRE(file.read_next(reinterpret_cast<const uint8_t *>(tile.data()), tile.size()));
+                else
+                {
+                    std::istringstream tile_stream(tile);
+                    REQUIRE(file.read_next(tile_stream));
+                }
+                CHECK(file.get_comments() == reference.get_comments());
+                CHECK(file.get_element_offsets() == reference.get_element_offsets());
+                CHECK(vertices->count == vertex_count);
+                CHECK(faces->count == vertex_count / 2);
+                REQUIRE(vertices->buffer.size_bytes() == ref_vertices->buffer.size_bytes());
+                CHECK(std::memcmp(vertices->buffer.get_const(), ref_vertices->buffer.get_const(), vertices->buffer.size_bytes()) == 0);
+                REQUIRE(faces->buffer.size_bytes() == ref_faces->buffer.size_bytes());
+                CHECK(std::memcmp(faces->buffer.get_const(), ref_faces->buffer.get_const(), faces->buffer.size_bytes()) == 0);
+                CHECK(std::memcmp(faces->offsets.get_const(), ref_faces->offsets.get_const(), (faces->count + 1) * faces->offsetStride) == 0);
+            }
+            if (vertex_count == 12 && !binary) CHECK(vertices->buffer.get_const() == first_buffer); // large enough to be reused
+        }
+
+        // A header that differs in anything but counts and comments is refused
+        PlyFile other;
+        other.add_properties_to_element("vertex", { "x", "y" }, Type::FLOAT32, 0, nullptr, Type::INVALID, 0);
+        std::ostringstream os;
+        other.write(os, binary);
+        const std::string mismatch = os.str();
+        CHECK_FALSE(file.read_next(reinterpret_cast<const uint8_t *>(mismatch.data()), mismatch.size()));
+        CHECK(vertices->count == 7);
+    }
+}
+
+TEST_CASE("parallel binary reads match serial reads")
+{
+    // Rows of vertex, face (with lists) and edge elements, written out in either byte order
+    auto make_file = [](const bool big_endian)
+    {
+        std::string ply = std::string("ply\nformat ") + (big_endian ? "binary_big_endian" : "binary_little_endian") + " 1.0\n"
+            "element vertex 300000\nproperty float x\nproperty float y\nproperty float z\n"
+            "element face 20000\nproperty list uchar int vertex_indices\n"
+            "element edge 100000\nproperty int vertex1\nproperty int vertex2\nend_header\n";
+        auto put = [&](const void * value, const size_t bytes)
+        {
+            const char * p = static_cast<const char *>(value);
+            for (size_t i = 0; i < bytes; ++i) ply += p[big_endian ? bytes - 1 - i : i];
+        };
+        for (uint32_t i = 0; i < 300000 * 3; ++i) { const float v = static_cast<float>(i) * 0.5f; put(&v, 4); }
+        for (uint32_t row = 0; row < 20000; ++row)
+        {
+            const uint8_t count = static_cast<uint8_t>(3 + row % 3);
+            put(&count, 1);
+            for (int32_t i = 0; i < count; ++i) { const int32_t v = static_cast<int32_t>(row) * 5 + i; put(&v, 4); }
+        }
+        for (int32_t i = 0; i < 100000 * 2; ++i) put(&i, 4);
+        return ply;
+    };
+
+    struct Result { std::shared_ptr<PlyData> vertices, faces, edges; };
+    auto request = [](PlyFile & file)
+    {
+        Result r;
+        r.vertices = file.request_properties_from_element("vertex", { "x", "y", "z" });
+        r.faces = file.request_properties_from_element("face", { "vertex_indices" });
+        r.edges = file.request_properties_from_element("edge", { "vertex1", "vertex2" });
+        return r;
+    };
+    auto same = [](const std::shared_ptr<PlyData> & a, const std::shared_ptr<PlyData> & b)
+    {
+        return a->buffer.size_bytes() == b->buffer.size_bytes() && std::memcmp(a->buffer.get_const(), b->buffer.get_const(), a->buffer.size_bytes()) == 0;
+    };
+
+    for (const bool big_endian : { false, true })
+    {
+        const std::string ply = make_file(big_endian);
+        const std::vector<uint8_t> bytes(ply.begin(), ply.end());
+
+        PlyFile serial;
+        REQUIRE(serial.parse_header(bytes.data(), bytes.size()));
+        const Result expected = request(serial);
+        serial.read(bytes.data(), bytes.size());
+
+        // The edges follow an element with lists, so they are located once it has been walked,
+        // unless the sidecar index knows where they begin
+        const std::string path = "parallel-binary-test.ply";
+        {
+            std::ofstream out(path, std::ios::binary);
+            out.write(ply.data(), ply.size());
+        }
+        std::remove((path + ".idx").c_str());
+        for (const bool indexed : { false, true, true })
+        {
+            PlyFile parallel;
+            REQUIRE(parallel.parse_header(bytes.data(), bytes.size()));
+            CHECK(parallel.use_sidecar_index(path) == indexed);
+            const Result actual = request(parallel);
+            parallel.read_parallel(bytes.data(), bytes.size(), 4);
+            CHECK(same(actual.vertices, expected.vertices));
+            CHECK(same(actual.faces, expected.faces));
+            CHECK(same(actual.edges, expected.edges));
+            CHECK(std::memcmp(actual.faces->offsets.get_const(), expected.faces->offsets.get_const(), (expected.faces->count + 1) * expected.faces->offsetStride) == 0);
+            CHECK(parallel.get_element_offsets() == serial.get_element_offsets());
+        }
+        std::remove((path + ".idx").c_str());
+        std::remove(path.c_str());
+    }
+}
+
+TEST_CASE("binary writes interleave rows from separately added property groups")
+{
+    const size_t count = 70000; // more rows than fit in one write block
+    std::vector<float> x(count), yz(2 * count);
+    std::vector<uint8_t> rgb(3 * count);
+    std::vector<uint32_t> offsets(1, 0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        x[i] = static_cast<float>(i);
+        yz[2 * i] = static_cast<float>(i) + 0.25f;
+        yz[2 * i + 1] = static_cast<float>(i) + 0.5f;
+        for (size_t c = 0; c < 3; ++c) rgb[3 * i + c] = static_cast<uint8_t>(i + c);
+        offsets.push_back(offsets.back() + static_cast<uint32_t>(i % 4));
+    }
+    std::vector<int16_t> values(offsets.back());
+    for (size_t i = 0; i < values.size(); ++i) values[i] = static_cast<int16_t>(i);
+
+    PlyFile file;
+    file.add_properties_to_element("vertex", { "x" }, Type::FLOAT32, count, reinterpret_cast<const uint8_t *>(x.data()), Type::INVALID, 0);
+    file.add_properties_to_element("vertex", { "y", "z" }, Type::FLOAT32, count, reinterpret_cast<const uint8_t *>(yz.data()), Type::INVALID, 0);
+    file.add_properties_to_element("vertex", { "red", "green", "blue" }, Type::UINT8, count, rgb.data(), Type::INVALID, 0);
+    file.add_list_property_to_element("strip", "values", Type::INT16, count, reinterpret_cast<const uint8_t *>(values.data()), Type::UINT8, offsets.data());
+    std::ostringstream os;
+    file.write(os, true);
+    const std::string ply = os.str();
+
+    // The payload is exactly the rows in file order
+    std::string expected;
+    auto put = [&](const void * p, const size_t n) { expected.append(static_cast<const char *>(p), n); };
+    for (size_t i = 0; i < count; ++i) { put(&x[i], 4); put(&yz[2 * i], 8); put(&rgb[3 * i], 3); }
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint8_t length = static_cast<uint8_t>(offsets[i + 1] - offsets[i]);
+        put(&length, 1);
+        put(values.data() + offsets[i], length * sizeof(int16_t));
+    }
+    REQUIRE(ply.size() > expected.size());
+    CHECK(ply.compare(ply.size() - expected.size(), expected.size(), expected) == 0);
+    CHECK(ply.compare(ply.size() - expected.size() - 11, 11, "end_header\n") == 0);
+}
+
+TEST_CASE("parallel writes match serial writes")
+{
+    const size_t count = 100000; // several ranges of rows per element
+    std::vector<float> xyz(3 * count);
+    std::vector<double> w(count);
+    std::vector<uint32_t> offsets(1, 0);
+    std::vector<int32_t> fixed(3 * count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (size_t c = 0; c < 3; ++c) xyz[3 * i + c] = static_cast<float>(i) / (c + 3);
+        w[i] = static_cast<double>(i) * 0.1;
+        for (size_t c = 0; c < 3; ++c) fixed[3 * i + c] = static_cast<int32_t>(i + c);
+        offsets.push_back(offsets.back() + static_cast<uint32_t>(i % 5));
+    }
+    std::vector<uint16_t> values(offsets.back());
+    for (size_t i = 0; i < values.size(); ++i) values[i] = static_cast<uint16_t>(i);
+
+    PlyFile file;
+    file.add_properties_to_element("vertex", { "x", "y", "z" }, Type::FLOAT32, count, reinterpret_cast<const uint8_t *>(xyz.data()), Type::INVALID, 0);
+    file.add_properties_to_element("vertex", { "w" }, Type::FLOAT64, count, reinterpret_cast<const uint8_t *>(w.data()), Type::INVALID, 0);
+    file.add_properties_to_element("face", { "vertex_indices" }, Type::INT32, count, reinterpret_cast<const uint8_t *>(fixed.data()), Type::UINT8, 3);
+    file.add_list_property_to_element("strip", "values", Type::UINT16, count, reinterpret_cast<const uint8_t *>(values.data()), Type::UINT32, offsets.data());
+
+    for (bool binary : { true, false })
+    {
+        std::ostringstream serial, parallel;
+        file.write(serial, binary);
+        file.write_parallel(parallel, binary, 4);
+        CHECK(serial.str() == parallel.str());
+    }
+}
+
+TEST_CASE("big-endian writes read back without touching the source buffers")
+{
+    const size_t count = 70000; // more rows than fit in one write block
+    std::vector<float> xyz(3 * count);
+    std::vector<uint8_t> rgb(3 * count);
+    std::vector<uint32_t> offsets(1, 0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (size_t c = 0; c < 3; ++c) xyz[3 * i + c] = static_cast<float>(i) + 0.25f * c;
+        for (size_t c = 0; c < 3; ++c) rgb[3 * i + c] = static_cast<uint8_t>(i + c);
+        offsets.push_back(offsets.back() + static_cast<uint32_t>(i % 4));
+    }
+    std::vector<int32_t> indices(offsets.back());
+    for (size_t i = 0; i < indices.size(); ++i) indices[i] = static_cast<int32_t>(i);
+    const std::vector<float> xyz_copy = xyz;
+    const std::vector<int32_t> indices_copy = indices;
+
+    PlyFile file;
+    file.add_properties_to_element("vertex", { "x", "y", "z" }, Type::FLOAT32, count, reinterpret_cast<const uint8_t *>(xyz.data()), Type::INVALID, 0);
+    file.add_list_property_to_element("face", "vertex_indices", Type::INT32, count, reinterpret_cast<const uint8_t *>(indices.data()), Type::UINT16, offsets.data());
+    file.set_big_endian(true);
+    std::ostringstream serial, parallel;
+    file.write(serial, true);
+    file.write_parallel(parallel, true, 4);
+    CHECK(xyz == xyz_copy);
+    CHECK(indices == indices_copy);
+    CHECK(serial.str() == parallel.str());
+    CHECK(serial.str().find("format binary_big_endian 1.0") != std::string::npos);
+
+    // The first vertex coordinate is stored most significant byte first
+    const std::string ply = serial.str();
+    const size_t payload = ply.find("end_header\n") + 11;
+    const float y0 = xyz[1];
+    uint8_t le[4];
+    std::memcpy(le, &y0, 4);
+    CHECK(static_cast<uint8_t>(ply[payload + 4]) == le[3]);
+    CHECK(static_cast<uint8_t>(ply[payload + 7]) == le[0]);
+
+    std::istringstream is(ply);
+    PlyFile in;
+    REQUIRE(in.parse_header(is));
+    auto vertices = in.request_properties_from_element("vertex", { "x", "y", "z" });
+    auto faces = in.request_properties_from_element("face", { "vertex_indices" });
+    in.read(is);
+    REQUIRE(vertices->buffer.size_bytes() == xyz.size() * sizeof(float));
+    CHECK(std::memcmp(vertices->buffer.get(), xyz.data(), vertices->buffer.size_bytes()) == 0);
+    REQUIRE(faces->buffer.size_bytes() == indices.size() * sizeof(int32_t));
+    CHECK(std::memcmp(faces->buffer.get(), indices.data(), faces->buffer.size_bytes()) == 0);
+    for (size_t i = 0; i <= count; i += 997) CHECK(faces->list_offset(i) == offsets[i]);
+
+    // Mixed value widths are swapped property by property
+    PlyFile mixed;
+    mixed.add_properties_to_element("vertex", { "x", "y", "z" }, Type::FLOAT32, count, reinterpret_cast<const uint8_t *>(xyz.data()), Type::INVALID, 0);
+    mixed.add_properties_to_element("vertex", { "red", "green", "blue" }, Type::UINT8, count, rgb.data(), Type::INVALID, 0);
+    mixed.set_big_endian(true);
+    std::ostringstream mixed_os;
+    mixed.write(mixed_os, true);
+    std::istringstream mixed_is(mixed_os.str());
+    PlyFile mixed_in;
+    REQUIRE(mixed_in.parse_header(mixed_is));
+    auto positions = mixed_in.request_properties_from_element("vertex", { "x", "y", "z" });
+    auto colors = mixed_in.request_properties_from_element("vertex", { "red", "green", "blue" });
+    mixed_in.read(mixed_is);
+    CHECK(std::memcmp(positions->buffer.get(), xyz.data(), xyz.size() * sizeof(float)) == 0);
+    CHECK(std::memcmp(colors->buffer.get(), rgb.data(), rgb.size()) == 0);
+}
+
+TEST_CASE("read statistics account for every element and allocation")
+{
+    const size_t count = 5000;
+    std::vector<float> xyz(3 * count);
+    std::vector<uint16_t> extra(count);
+    std::vector<uint32_t> offsets(1, 0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (size_t c = 0; c < 3; ++c) xyz[3 * i + c] = static_cast<float>(i + c);
+        extra[i] = static_cast<uint16_t>(i);
+        offsets.push_back(offsets.back() + static_cast<uint32_t>(3 + i % 3));
+    }
+    std::vector<uint32_t> indices(offsets.back());
+    for (size_t i = 0; i < indices.size(); ++i) indices[i] = static_cast<uint32_t>(i);
+
+    PlyFile out;
+    out.add_properties_to_element("vertex", { "x", "y", "z" }, Type::FLOAT32, count, reinterpret_cast<const uint8_t *>(xyz.data()), Type::INVALID, 0);
+    out.add_properties_to_element("extra", { "value" }, Type::UINT16, count, reinterpret_cast<const uint8_t *>(extra.data()), Type::INVALID, 0);
+    out.add_list_property_to_element("face", "vertex_indices", Type::UINT32, count, reinterpret_cast<const uint8_t *>(indices.data()), Type::UINT8, offsets.data());
+
+    for (bool big_endian : { false, true })
+    {
+        out.set_big_endian(big_endian);
+        std::ostringstream os;
+        out.write(os, true);
+        const std::string ply = os.str();
+        const size_t payload = ply.size() - (ply.find("end_header\n") + 11);
+
+        std::vector<PlyReadStats> reports;
+        PlyFile file;
+        file.set_stats_sink([&](const PlyReadStats & s) { reports.push_back(s); });
+        std::istringstream is(ply);
+        REQUIRE(file.parse_header(is));
+        auto vertices = file.request_properties_from_element("vertex", { "x", "y", "z" });
+        auto faces = file.request_properties_from_element("face", { "vertex_indices" });
+        file.read(is);
+        file.read_parallel(reinterpret_cast<const uint8_t *>(ply.data()), ply.size(), 4);
+
+        REQUIRE(reports.size() == 2);
+        for (const PlyReadStats & s : reports)
+        {
+            REQUIRE(s.elements.size() == 3);
+            CHECK(s.elements[0].name == "vertex");
+            CHECK(s.elements[0].rows_decoded == count);
+            CHECK(s.elements[0].bytes_read == count * 12);
+            CHECK(s.elements[1].rows_decoded == 0);
+            CHECK(s.elements[1].bytes_skipped == count * 2);
+            CHECK(s.elements[2].rows_decoded == count);
+            CHECK(s.elements[0].bytes_read + s.elements[1].bytes_skipped + s.elements[2].bytes_read == payload);
+            CHECK(s.total_ms >= s.decode_ms);
+            CHECK(s.allocations > 0);
+        }
+
+        // The stream read grows the face buffer from `initial_list_length` values per row
+        CHECK(reports[0].header_ms > 0);
+        CHECK(reports[0].bytes_allocated > count * 12 + indices.size() * 4);
+        CHECK(reports[1].header_ms == 0);
+        CHECK(std::memcmp(faces->buffer.get(), indices.data(), faces->buffer.size_bytes()) == 0);
+
+        file.set_stats_sink(nullptr);
+        file.read(reinterpret_cast<const uint8_t *>(ply.data()), ply.size());
+        CHECK(reports.size() == 2);
+    }
+}
+
+// Serves `bytes` in chunks of varying size, like a decompressor would
+struct ChunkedDecompressor : public PlyDecompressor
+{
+    std::string bytes;
+    size_t at{ 0 }, calls{ 0 }, fail_after{ std::string::npos };
+    explicit ChunkedDecompressor(const std::string & b) : bytes(b) {}
+    size_t decompress(uint8_t * out, const size_t capacity) override
+    {
+        if (at >= fail_after) throw std::runtime_error("corrupt input");
+        const size_t n = std::min(std::min(capacity, 1 + (++calls * 7919) % 20000), bytes.size() - at);
+        std::memcpy(out, bytes.data() + at, n);
+        at += n;
+        return n;
+    }
+};
+
+struct CollectingCompressor : public PlyCompressor
+{
+    std::string & bytes;
+    bool & finished;
+    CollectingCompressor(std::string & b, bool & f) : bytes(b), finished(f) {}
+    void compress(const uint8_t * data, const size_t size) override { bytes.append(reinterpret_cast<const char *>(data), size); }
+    void finish() override { finished = true; }
+};
+
+TEST_CASE("files are read and written through pipelined codec streams")
+{
+    const size_t count = 20000;
+    std::vector<float> xyz(3 * count);
+    std::vector<uint32_t> offsets(1, 0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (size_t c = 0; c < 3; ++c) xyz[3 * i + c] = static_cast<float>(i) * 0.5f + c;
+        offsets.push_back(offsets.back() + static_cast<uint32_t>(i % 6));
+    }
+    std::vector<int32_t> indices(offsets.back());
+    for (size_t i = 0; i < indices.size(); ++i) indices[i] = static_cast<int32_t>(i);
+
+    PlyFile out;
+    out.add_properties_to_element("vertex", { "x", "y", "z" }, Type::FLOAT32, count, reinterpret_cast<const uint8_t *>(xyz.data()), Type::INVALID, 0);
+    out.add_list_property_to_element("face", "vertex_indices", Type::INT32, count, reinterpret_cast<const uint8_t *>(indices.data()), Type::UINT8, offsets.data());
+
+    for (bool binary : { true, false })
+    {
+        std::ostringstream plain;
+        out.write(plain, binary);
+
+        // Small blocks in a short ring, so that both sides wait on each other
+        std::string written;
+        bool finished = false;
+        {
+            PlyCompressingStream os(std::unique_ptr<PlyCompressor>(new CollectingCompressor(written, finished)), 4096, 2);
+            out.write(os, binary);
+            os.close();
+        }
+        CHECK(finished);
+        CHECK(written == plain.str());
+
+        PlyDecompressingStream is(std::unique_ptr<PlyDecompressor>(new ChunkedDecompressor(written)), 4096, 3);
+        PlyFile file;
+        REQUIRE(file.parse_header(is));
+        auto vertices = file.request_properties_from_element("vertex", { "x", "y", "z" });
+        auto faces = file.request_properties_from_element("face", { "vertex_indices" });
+        file.read(is);
+        REQUIRE(vertices->buffer.size_bytes() == xyz.size() * sizeof(float));
+        CHECK(std::memcmp(vertices->buffer.get(), xyz.data(), vertices->buffer.size_bytes()) == 0);
+        REQUIRE(faces->buffer.size_bytes() == indices.size() * sizeof(int32_t));
+        CHECK(std::memcmp(faces->buffer.get(), indices.data(), faces->buffer.size_bytes()) == 0);
+    }
+
+    // Codec errors surface from the read
+    std::ostringstream plain;
+    out.write(plain, true);
+    ChunkedDecompressor * failing = new ChunkedDecompressor(plain.str());
+    failing->fail_after = plain.str().size() / 2;
+    PlyDecompressingStream is{ std::unique_ptr<PlyDecompressor>(failing) };
+    PlyFile file;
+    REQUIRE(file.parse_header(is));
+    file.request_properties_from_element("face", { "vertex_indices" });
+    CHECK_THROWS_WITH(file.read(is), "corrupt input");
+
+#if defined(TINYPLY_WITH_ZLIB)
+    std::ostringstream gz;
+    {
+        PlyCompressingStream os(std::unique_ptr<PlyCompressor>(new PlyGzipCompressor(gz)));
+        out.write(os, true);
+        os.close();
+    }
+    CHECK(gz.str().size() < plain.str().size());
+    std::istringstream gz_in(gz.str());
+    PlyDecompressingStream unzipped(std::unique_ptr<PlyDecompressor>(new PlyGzipDecompressor(gz_in)));
+    const std::string round_trip((std::istreambuf_iterator<char>(unzipped)), std::istreambuf_iterator<char>());
+    CHECK(round_trip == plain.str());
+#endif
+}
+
+TEST_CASE("files are read through a prefetching stream")
+{
+    const size_t count = 30000;
+    std::vector<double> xyz(3 * count);
+    std::vector<uint32_t> offsets(1, 0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (size_t c = 0; c < 3; ++c) xyz[3 * i + c] = static_cast<double>(i) / (c + 1);
+        offsets.push_back(offsets.back() + static_cast<uint32_t>(3 + i % 2));
+    }
+    std::vector<uint32_t> indices(offsets.back());
+    for (size_t i = 0; i < indices.size(); ++i) indices[i] = static_cast<uint32_t>(i % count);
+
+    const std::string path = "prefetch-test.ply";
+    {
+        PlyFile out;
+        out.add_properties_to_element("vertex", { "x", "y", "z" }, Type::FLOAT64, count, reinterpret_cast<const uint8_t *>(xyz.data()), Type::INVALID, 0);
+        out.add_list_property_to_element("face", "vertex_indices", Type::UINT32, count, reinterpret_cast<const uint8_t *>(indices.data()), Type::UINT8, offsets.data());
+        std::ofstream os(path, std::ios::binary);
+        out.write(os, true);
+    }
+
+    // Blocks smaller than the header and ring wrap-around along the way
+    for (size_t block_bytes : { size_t(64), size_t(4096), size_t(4) << 20 })
+    {
+        PlyPrefetchingStream is(path, block_bytes, 2);
+        PlyFile file;
+        REQUIRE(file.parse_header(is));
+        auto vertices = file.request_properties_from_element("vertex", { "x", "y", "z" });
+        auto faces = file.request_properties_from_element("face", { "vertex_indices" }, 3);
+        file.read(is);
+        REQUIRE(vertices->buffer.size_bytes() == xyz.size() * sizeof(double));
+        CHECK(std::memcmp(vertices->buffer.get(), xyz.data(), vertices->buffer.size_bytes()) == 0);
+        REQUIRE(faces->buffer.size_bytes() == indices.size() * sizeof(uint32_t));
+        CHECK(std::memcmp(faces->buffer.get(), indices.data(), faces->buffer.size_bytes()) == 0);
+    }
+    std::remove(path.c_str());
+
+    CHECK_THROWS_AS(PlyPrefetchingStream("does-not-exist.ply"), std::runtime_error);
+}
+
+TEST_CASE("windows of rows are read without decoding the rest of the file")
+{
+    const size_t count = 10000; // faces span several checkpoints of the sidecar index
+    std::vector<float> xyz(3 * count);
+    std::vector<int32_t> edges(2 * count);
+    std::vector<uint32_t> offsets(1, 0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (size_t c = 0; c < 3; ++c) xyz[3 * i + c] = static_cast<float>(i) + c * 0.25f;
+        for (size_t c = 0; c < 2; ++c) edges[2 * i + c] = static_cast<int32_t>(i + c);
+        offsets.push_back(offsets.back() + static_cast<uint32_t>(3 + i % 3));
+    }
+    std::vector<uint32_t> indices(offsets.back());
+    for (size_t i = 0; i < indices.size(); ++i) indices[i] = static_cast<uint32_t>(i % count);
+
+    auto slice = [](const void * data, const size_t stride, const size_t begin, const size_t end)
+    {
+        const uint8_t * bytes = static_cast<const uint8_t *>(data);
+        return std::vector<uint8_t>(bytes + begin * stride, bytes + end * stride);
+    };
+    auto contents = [](const std::shared_ptr<PlyData> & d)
+    {
+        return std::vector<uint8_t>(d->buffer.get_const(), d->buffer.get_const() + d->buffer.size_bytes());
+    };
+
+    const std::string path = "range-test.ply";
+    for (const bool big_endian : { false, true })
+    {
+        {
+            PlyFile out;
+            out.add_properties_to_element("vertex", { "x", "y", "z" }, Type::FLOAT32, count, reinterpret_cast<const uint8_t *>(xyz.data()), Type::INVALID, 0);
+            out.add_list_property_to_element("face", "vertex_indices", Type::UINT32, count, reinterpret_cast<const uint8_t *>(indices.data()), Type::UINT8, offsets.data());
+            out.add_properties_to_element("edge", { "vertex1", "vertex2" }, Type::INT32, count, reinterpret_cast<const uint8_t *>(edges.data()), Type::INVALID, 0);
+            out.set_big_endian(big_endian);
+            std::ofstream os(path, std::ios::binary);
+            out.write(os, true);
+        }
+        std::remove((path + ".idx").c_str());
+        const std::vector<uint8_t> bytes = read_file_binary(path);
+
+        // Without and with the sidecar index, which the first full read writes
+        for (const bool indexed : { false, true })
+        {
+            if (indexed)
+            {
+                PlyFile full;
+                REQUIRE(full.parse_header(bytes.data(), bytes.size()));
+                full.use_sidecar_index(path);
+                full.request_properties_from_element("face", { "vertex_indices" });
+                full.read(bytes.data(), bytes.size());
+            }
+
+            for (const int source : { 0, 1, 2 })
+            {
+                std::ifstream is(path, std::ios::binary);
+                PlyFile file;
+                if (source == 0) REQUIRE(file.parse_header(bytes.data(), bytes.size()));
+                if (source == 1) REQUIRE(file.parse_header(is));
+                if (source == 2) REQUIRE(file.open_mapped(path));
+                CHECK(file.use_sidecar_index(path) == indexed);
+                auto vertices = file.request_properties_from_element("vertex", { "x", "y", "z" });
+                auto faces = file.request_properties_from_element("face", { "vertex_indices" });
+                auto e = file.request_properties_from_element("edge", { "vertex1", "vertex2" });
+
+                const std::pair<size_t, size_t> windows[] = { { 0, count }, { 5000, 3000 }, { 9999, 1 }, { 4096, 4096 }, { count, 0 } };
+                for (auto & w : windows)
+                {
+                    for (const char * element : { "edge", "face", "vertex" })
+                    {
+                        if (source == 0) file.read_range(bytes.data(), bytes.size(), element, w.first, w.second);
+                        if (source == 1) file.read_range(is, element, w.first, w.second);
+                        if (source == 2) file.read_range(element, w.first, w.second);
+                    }
+                    CHECK(vertices->count == w.second);
+                    CHECK(contents(vertices) == slice(xyz.data(), 12, w.first, w.first + w.second));
+                    CHECK(contents(e) == slice(edges.data(), 8, w.first, w.first + w.second));
+                    CHECK(faces->count == w.second);
+                    CHECK(contents(faces) == slice(indices.data(), 4, offsets[w.first], offsets[w.first + w.second]));
+                }
+                CHECK(file.get_element_offsets()[2] > 0);
+                CHECK(file.get_elements()[1].size == count);
+
+                CHECK_THROWS_AS(file.read_range(bytes.data(), bytes.size(), "edge", count - 1, 2), std::invalid_argument);
+                CHECK_THROWS_AS(file.read_range(bytes.data(), bytes.size(), "tristrips", 0, 1), std::invalid_argument);
+            }
+        }
+        std::remove((path + ".idx").c_str());
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("headers are tokenized on any whitespace, from memory and streams alike")
+{
+    const std::string ply = "ply\r\nformat binary_little_endian 1.0\r\ncomment  two spaces\r\n  element\tvertex 2 \r\n"
+        "property float x\r\nproperty\tfloat  y\r\nproperty list uchar int idx\r\nobj_info x\r\nend_header\r\n";
+    std::string bytes = ply;
+    const float rows[] = { 1.0f, 2.0f, 3.0f, 4.0f };
+    for (size_t i = 0; i < 2; ++i)
+    {
+        bytes.append(reinterpret_cast<const char *>(rows + 2 * i), 8);
+        bytes.append("\1\5\0\0\0", 5);
+    }
+
+    for (const bool from_memory : { true, false })
+    {
+        std::istringstream is(bytes);
+        PlyFile file;
+        if (from_memory) REQUIRE(file.parse_header(reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size()));
+        else REQUIRE(file.parse_header(is));
+        if (!from_memory) CHECK(static_cast<size_t>(is.tellg()) == ply.size());
+        CHECK(file.get_element_offsets()[0] == static_cast<int64_t>(ply.size()));
+        CHECK(file.get_comments() == std::vector<std::string>{ " two spaces\r" });
+        CHECK(file.get_info() == std::vector<std::string>{ "x\r" });
+
+        const std::vector<PlyElement> elements = file.get_elements();
+        REQUIRE(elements.size() == 1);
+        CHECK(elements[0].name == "vertex");
+        CHECK(elements[0].size == 2);
+        REQUIRE(elements[0].properties.size() == 3);
+        CHECK(elements[0].properties[1].name == "y");
+        CHECK(elements[0].properties[2].isList);
+        CHECK(elements[0].properties[2].listType == Type::UINT8);
+        CHECK(elements[0].properties[2].propertyType == Type::INT32);
+
+        auto xy = file.request_properties_from_element("vertex", { "x", "y" });
+        auto idx = file.request_properties_from_element("vertex", { "idx" });
+        CHECK_THROWS_AS(file.request_properties_from_element("vertex", { "y" }), std::invalid_argument);
+        if (from_memory) file.read(reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size());
+        else file.read(is);
+        REQUIRE(xy->buffer.size_bytes() == sizeof(rows));
+        CHECK(std::memcmp(xy->buffer.get(), rows, sizeof(rows)) == 0);
+        CHECK(reinterpret_cast<const int32_t *>(idx->buffer.get())[1] == 5);
+    }
+}
+
+TEST_CASE("columns are exported to arrow without copying their buffers")
+{
+    const size_t count = 1000;
+    std::vector<float> xyz(3 * count);
+    std::vector<uint8_t> rgb(3 * count);
+    std::vector<uint32_t> offsets(1, 0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (size_t c = 0; c < 3; ++c) xyz[3 * i + c] = static_cast<float>(i) + c * 0.5f;
+        for (size_t c = 0; c < 3; ++c) rgb[3 * i + c] = static_cast<uint8_t>(i + c);
+        offsets.push_back(offsets.back() + static_cast<uint32_t>(3 + i % 2));
+    }
+    std::vector<int32_t> indices(offsets.back());
+    for (size_t i = 0; i < indices.size(); ++i) indices[i] = static_cast<int32_t>(i % count);
+
+    std::ostringstream os;
+    {
+        PlyFile out;
+        out.add_properties_to_element("vertex", { "x", "y", "z" }, Type::FLOAT32, count, reinterpret_cast<const uint8_t *>(xyz.data()), Type::INVALID, 0);
+        out.add_properties_to_element("vertex", { "red", "green", "blue" }, Type::UINT8, count, rgb.data(), Type::INVALID, 0);
+        out.add_list_property_to_element("face", "vertex_indices", Type::INT32, count, reinterpret_cast<const uint8_t *>(indices.data()), Type::UINT8, offsets.data());
+        out.write(os, true);
+    }
+    const std::string bytes = os.str();
+
+    PlyFile file;
+    REQUIRE(file.parse_header(reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size()));
+    std::vector<std::shared_ptr<PlyData>> columns = file.request_columns_from_element("vertex", { "x", "y", "z" });
+    REQUIRE(columns.size() == 3);
+    auto colors = file.request_properties_from_element("vertex", { "red", "green", "blue" });
+    auto faces = file.request_properties_from_element("face", { "vertex_indices" });
+    file.read(reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size());
+
+    for (size_t c = 0; c < 3; ++c)
+    {
+        REQUIRE(columns[c]->buffer.size_bytes() == count * sizeof(float));
+        CHECK(reinterpret_cast<uintptr_t>(columns[c]->buffer.get()) % Buffer::alignment == 0);
+        for (size_t i = 0; i < count; ++i) CHECK(columns[c]->view<float>()[i] == xyz[3 * i + c]);
+    }
+
+    // Nothing is handed over unless every column fits
+    auto fewer = std::make_shared<PlyData>();
+    fewer->t = Type::FLOAT32;
+    fewer->count = count - 1;
+    ArrowSchema schema;
+    ArrowArray array;
+    CHECK_THROWS_AS(export_arrow({ { "x", columns[0] }, { "bad", fewer } }, &schema, &array), std::invalid_argument);
+    CHECK(columns[0]->buffer.size_bytes() == count * sizeof(float));
+
+    const void * x_values = columns[0]->buffer.get();
+    const void * color_values = colors->buffer.get();
+    const void * face_values = faces->buffer.get();
+    const void * face_offsets = faces->offsets.get();
+    export_arrow({ { "x", columns[0] }, { "y", columns[1] }, { "z", columns[2] }, { "rgb", colors }, { "vertex_indices", faces } }, &schema, &array);
+    CHECK(columns[0]->buffer.size_bytes() == 0);
+    CHECK(faces->offsets.size_bytes() == 0);
+
+    CHECK(std::string(schema.format) == "+s");
+    REQUIRE(schema.n_children == 5);
+    REQUIRE(array.n_children == 5);
+    CHECK(array.length == static_cast<int64_t>(count));
+    CHECK(std::string(schema.children[0]->name) == "x");
+    CHECK(std::string(schema.children[0]->format) == "f");
+    CHECK(array.children[0]->length == static_cast<int64_t>(count));
+    CHECK(array.children[0]->buffers[1] == x_values);
+
+    CHECK(std::string(schema.children[3]->format) == "+w:3");
+    CHECK(std::string(schema.children[3]->children[0]->format) == "C");
+    CHECK(array.children[3]->children[0]->length == static_cast<int64_t>(3 * count));
+    CHECK(array.children[3]->children[0]->buffers[1] == color_values);
+
+    CHECK(std::string(schema.children[4]->format) == "+l");
+    CHECK(std::string(schema.children[4]->children[0]->format) == "i");
+    CHECK(array.children[4]->buffers[1] == face_offsets);
+    const ArrowArray * face_array = array.children[4]->children[0];
+    CHECK(face_array->length == static_cast<int64_t>(indices.size()));
+    CHECK(face_array->buffers[1] == face_values);
+    CHECK(std::memcmp(face_array->buffers[1], indices.data(), indices.size() * sizeof(int32_t)) == 0);
+    CHECK(std::memcmp(array.children[4]->buffers[1], offsets.data(), offsets.size() * sizeof(uint32_t)) == 0);
+
+    // A child moved out by the consumer is released on its own, and skipped by its parent
+    ArrowArray moved = *array.children[1];
+    array.children[1]->release = nullptr;
+    moved.release(&moved);
+    CHECK(moved.release == nullptr);
+
+    schema.release(&schema);
+    array.release(&array);
+    CHECK(schema.release == nullptr);
+    CHECK(array.release == nullptr);
+
+    // Views into a mapping keep it alive for as long as the array holds them
+    const std::string path = "arrow-test.ply";
+    {
+        PlyFile out;
+        out.add_properties_to_element("vertex", { "x", "y", "z" }, Type::FLOAT32, count, reinterpret_cast<const uint8_t *>(xyz.data()), Type::INVALID, 0);
+        std::ofstream fs(path, std::ios::binary);
+        out.write(fs, true);
+    }
+    std::shared_ptr<PlyData> positions;
+    {
+        PlyFile mapped;
+        REQUIRE(mapped.open_mapped(path));
+        positions = mapped.request_properties_from_element("vertex", { "x", "y", "z" });
+        mapped.read();
+    }
+    export_arrow({ { "position", positions } }, &schema, &array);
+    CHECK(std::memcmp(array.children[0]->children[0]->buffers[1], xyz.data(), count * 12) == 0);
+    schema.release(&schema);
+    array.release(&array);
+    std::remove(path.c_str());
+}
+
 //TEST_CASE("check that int128 is an unrecognized, non-conformant datatype")
 //{
 //    std::ifstream filestream("../assets/validate/invalid/header.invalid-face-data-type-int128.ply", std::ios::binary);
@@ -1,8 +1,12 @@
 /*
  * tinyply 2.3.4 (https://github.com/ddiakopoulos/tinyply)
  *
- * A single-header, zero-dependency (except the C++ STL) public domain implementation
- * of the PLY mesh file format. Requires C++11; errors are handled through exceptions.
+ * A single-header, public domain implementation of the PLY mesh file format. Requires C++11;
+ * errors are handled through exceptions. Besides the C++ STL, the implementation includes
+ * <windows.h> or the POSIX <fcntl.h>, <sys/mman.h>, <sys/stat.h> and <unistd.h> to map
+ * files, and <thread> for parallel reads, so it must be linked against the platform's
+ * threads library (-pthread, or CMake's find_package(Threads)). Defining TINYPLY_WITH_ZLIB
+ * adds the gzip codecs, which include <zlib.h> and need zlib at link time.
  *
  * This software is in the public domain. Where that dedication is not
  * recognized, you are granted a perpetual, irrevocable license to copy,
@@ -30,9 +34,50 @@
 #include <sstream>
 #include <memory>
 #include <unordered_map>
-#include <map>
 #include <algorithm>
 #include <functional>
+#include <stdexcept>
+#include <cstring>
+#include <type_traits>
+#include <mutex>
+
+// The Arrow C data interface (https://arrow.apache.org/docs/format/CDataInterface.html), an ABI that
+// needs no Arrow headers or libraries; see `tinyply::export_arrow`. Guarded as Arrow itself guards it.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SANITIZED 4
+
+struct ArrowSchema
+{
+    const char * format;
+    const char * name;
+    const char * metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema ** children;
+    struct ArrowSchema * dictionary;
+    void (*release)(struct ArrowSchema *);
+    void * private_data;
+};
+
+struct ArrowArray
+{
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void ** buffers;
+    struct ArrowArray ** children;
+    struct ArrowArray * dictionary;
+    void (*release)(struct ArrowArray *);
+    void * private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
 
 namespace tinyply
 {
@@ -50,41 +95,128 @@ namespace tinyply
         FLOAT64
     };
 
-    struct PropertyInfo
-    {
-        PropertyInfo() {};
-        PropertyInfo(int stride, std::string str)
-            : stride(stride), str(str) {}
-        int stride {0};
-        std::string str;
-    };
+    // Indexed by `Type`, which has `type_count` values; see `type_stride` and `type_name`
+    constexpr size_t type_count = 9;
+    constexpr uint8_t type_strides[type_count] = { 0, 1, 1, 2, 2, 4, 4, 4, 8 };
+    constexpr const char * type_names[type_count] = { "INVALID", "char", "uchar", "short", "ushort", "int", "uint", "float", "double" };
 
-    static std::map<Type, PropertyInfo> PropertyTable
-    {
-        { Type::INT8,    PropertyInfo(1, std::string("char")) },
-        { Type::UINT8,   PropertyInfo(1, std::string("uchar")) },
-        { Type::INT16,   PropertyInfo(2, std::string("short")) },
-        { Type::UINT16,  PropertyInfo(2, std::string("ushort")) },
-        { Type::INT32,   PropertyInfo(4, std::string("int")) },
-        { Type::UINT32,  PropertyInfo(4, std::string("uint")) },
-        { Type::FLOAT32, PropertyInfo(4, std::string("float")) },
-        { Type::FLOAT64, PropertyInfo(8, std::string("double")) },
-        { Type::INVALID, PropertyInfo(0, std::string("INVALID"))}
-    };
+    // The size in bytes of a value of type `t`, 0 for `Type::INVALID`
+    constexpr size_t type_stride(const Type t) { return static_cast<size_t>(t) < type_count ? type_strides[static_cast<size_t>(t)] : 0; }
+
+    // The name of `t` as written in a ply header
+    constexpr const char * type_name(const Type t) { return static_cast<size_t>(t) < type_count ? type_names[static_cast<size_t>(t)] : type_names[0]; }
+
+    // Maps a `Type` to the C++ type its values are stored as
+    template<Type T> struct TypeTraits;
+    template<> struct TypeTraits<Type::INT8>    { typedef int8_t   type; };
+    template<> struct TypeTraits<Type::UINT8>   { typedef uint8_t  type; };
+    template<> struct TypeTraits<Type::INT16>   { typedef int16_t  type; };
+    template<> struct TypeTraits<Type::UINT16>  { typedef uint16_t type; };
+    template<> struct TypeTraits<Type::INT32>   { typedef int32_t  type; };
+    template<> struct TypeTraits<Type::UINT32>  { typedef uint32_t type; };
+    template<> struct TypeTraits<Type::FLOAT32> { typedef float    type; };
+    template<> struct TypeTraits<Type::FLOAT64> { typedef double   type; };
 
     class Buffer
     {
         uint8_t * alias{ nullptr };
         struct delete_array { void operator()(uint8_t * p) { delete[] p; } };
         std::unique_ptr<uint8_t, decltype(Buffer::delete_array())> data;
+        std::shared_ptr<const void> owner; // keeps the memory behind a non-allocating view alive, if set
         size_t size {0};
+        size_t capacity {0}; // bytes allocated, for buffers that own their memory
     public:
+        static const size_t alignment = 64; // of the memory of allocating buffers, for SIMD consumers
         Buffer() {};
-        Buffer(const size_t size) : data(new uint8_t[size], delete_array()), size(size) { alias = data.get(); } // allocating
+        Buffer(const size_t size) : data(new uint8_t[size + alignment - 1], delete_array()), size(size), capacity(size) // allocating
+        {
+            alias = data.get() + (alignment - reinterpret_cast<uintptr_t>(data.get()) % alignment) % alignment;
+        }
         Buffer(const uint8_t * ptr): alias(const_cast<uint8_t*>(ptr)) { } // non-allocating, todo: set size?
+        Buffer(const uint8_t * ptr, const size_t size, std::shared_ptr<const void> owner = nullptr)
+            : alias(const_cast<uint8_t*>(ptr)), owner(owner), size(size) { } // non-allocating view of `size` bytes
         uint8_t * get() { return alias; }
         const uint8_t * get_const() const {return alias; }
+        void shrink(const size_t bytes) { size = std::min(size, bytes); } // reports fewer bytes; the memory itself is kept
+        bool reuse(const size_t bytes) { if (!data || bytes > capacity) return false; size = bytes; return true; } // resizes within the allocation, if it is large enough
         size_t size_bytes() const { return size; }
+
+        /*
+         * Hands the memory over to another owner (e.g. an Arrow buffer) without copying it, and leaves this
+         * buffer empty. The memory stays valid until `release(context)` is called, exactly once. An allocation
+         * is handed over as is; a view passes on the reference that keeps its memory alive (a mapping, or an
+         * arena, whose `reset()` still reclaims it), and a view of caller memory without one releases nothing.
+         */
+        struct Released
+        {
+            uint8_t * data{ nullptr };
+            size_t size{ 0 };
+            void * context{ nullptr };
+            void (*release)(void * context){ nullptr };
+        };
+        Released release()
+        {
+            Released r;
+            r.data = alias;
+            r.size = size;
+            if (data)
+            {
+                r.context = data.release();
+                r.release = [](void * p) { delete[] static_cast<uint8_t *>(p); };
+            }
+            else if (owner)
+            {
+                r.context = new std::shared_ptr<const void>(std::move(owner));
+                r.release = [](void * p) { delete static_cast<std::shared_ptr<const void> *>(p); };
+            }
+            else r.release = [](void *) {};
+            owner.reset();
+            alias = nullptr;
+            size = capacity = 0;
+            return r;
+        }
+    };
+
+    /*
+     * A region of memory that the buffers of reads are carved out of, in place of a heap allocation
+     * per buffer; see `PlyFile::use_arena`. Memory is handed out from blocks of (at least) `block_size`
+     * bytes, every allocation aligned to `Buffer::alignment`. `reset()` makes all of it available again,
+     * invalidating every buffer allocated so far; blocks are merged into one on the way, so that a
+     * steady stream of similar files settles into a single block that is reused for each of them.
+     * Allocations are serialized by a lock of the arena's own, so the threads of a parallel read
+     * can share one while separate arenas never contend; `reset()` must wait until no read uses it.
+     */
+    class PlyArena
+    {
+        struct Block
+        {
+            Buffer memory;
+            size_t used{ 0 };
+        };
+        std::vector<Block> blocks;
+        size_t block_size;
+        mutable std::mutex mutex;
+        size_t reserved_unlocked() const;
+    public:
+        explicit PlyArena(const size_t block_size = size_t(1) << 20);
+        uint8_t * allocate(const size_t bytes);
+        void reset();
+        size_t bytes_used() const;     // allocated since the last reset, alignment padding included
+        size_t bytes_reserved() const; // held in blocks
+    };
+
+    // A typed, non-owning view of a buffer; see `PlyData::view`
+    template<typename T> struct PlyView
+    {
+        T * ptr{ nullptr };
+        size_t count{ 0 };
+        PlyView(T * _ptr, const size_t _count) : ptr(_ptr), count(_count) {}
+        T * data() const { return ptr; }
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        T * begin() const { return ptr; }
+        T * end() const { return ptr + count; }
+        T & operator[](const size_t i) const { return ptr[i]; }
     };
 
     struct PlyData
@@ -93,6 +225,48 @@ namespace tinyply
         Buffer buffer;
         size_t count {0};
         bool isList {false};
+        Buffer offsets;          // list groups only: `count + 1` row offsets into `buffer`, counted in values
+        size_t offsetStride {0}; // 4 (uint32_t offsets), or 8 (uint64_t) once `buffer` may hold more than 2^32 - 1 values
+
+        /*
+         * Lists are returned CSR-style: the values of all rows back to back in `buffer`, with row `i`
+         * holding values [list_offset(i), list_offset(i + 1)). Lists may differ in length from row to row.
+         */
+        uint64_t list_offset(const size_t row) const
+        {
+            if (offsetStride == 8) { uint64_t v; std::memcpy(&v, offsets.get_const() + row * 8, 8); return v; }
+            uint32_t v;
+            std::memcpy(&v, offsets.get_const() + row * 4, 4);
+            return v;
+        }
+
+        /*
+         * The buffer as an array of `T`, without copying: e.g. `view<float3>()` for a {"x", "y", "z"}
+         * group of floats, or `view<uint32_t>()` for its flat list indices. Throws if `T` is not a whole
+         * number of values (or, for arithmetic `T`, not exactly one), or the buffer is not a whole number
+         * of `T`s. Buffers tinyply allocates are suitably aligned for any `T`; views into mapped or caller
+         * memory are as aligned as the file.
+         */
+        template<typename T> PlyView<T> view()
+        {
+            check_view(sizeof(T), std::is_arithmetic<T>::value);
+            return PlyView<T>(reinterpret_cast<T *>(buffer.get()), buffer.size_bytes() / sizeof(T));
+        }
+
+        template<typename T> PlyView<const T> view() const
+        {
+            check_view(sizeof(T), std::is_arithmetic<T>::value);
+            return PlyView<const T>(reinterpret_cast<const T *>(buffer.get_const()), buffer.size_bytes() / sizeof(T));
+        }
+
+    private:
+        void check_view(const size_t size, const bool scalar) const
+        {
+            if (type_stride(t) == 0 || size % type_stride(t) != 0 || (scalar && size != type_stride(t)) || buffer.size_bytes() % size != 0)
+            {
+                throw std::invalid_argument("view type does not tile the buffer: " + std::to_string(size) + " bytes over " + std::to_string(buffer.size_bytes()) + " bytes of " + type_name(t));
+            }
+        }
     };
 
     struct PlyProperty
@@ -105,7 +279,7 @@ namespace tinyply
         Type propertyType{ Type::INVALID };
         bool isList{ false };
         Type listType{ Type::INVALID };
-        size_t listCount {0};
+        size_t listCount {0}; // the length of every list, or 0 if lengths vary (see `PlyData::offsets`)
     };
 
     struct PlyElement
@@ -117,6 +291,66 @@ namespace tinyply
         std::vector<PlyProperty> properties;
     };
 
+    /*
+     * A pull-style cursor over the payload of a file, returned by `PlyFile::begin_stream(...)`. Each call
+     * to `next_chunk` decodes up to `max_rows` further rows of the next element with requested properties
+     * (elements are visited in file order; others are skipped over) and returns the number of rows decoded,
+     * or 0 once the last requested element is exhausted. Afterwards, every `PlyData` requested from that
+     * element holds just those rows: its `count` is the number of rows and its `buffer` views storage owned
+     * by the stream, which is reused (and only ever grown) from chunk to chunk, so memory stays proportional
+     * to the chunk rather than to the file. Copy out what is needed before the next call. Groups requested into
+     * caller-provided memory receive each chunk at the start of it. Streams need not be seekable.
+     */
+    struct PlyStream
+    {
+        struct PlyStreamImpl;
+        std::shared_ptr<PlyStreamImpl> impl;
+
+        size_t next_chunk(const size_t max_rows);
+        std::string element() const; // the element of the last chunk
+        size_t first_row() const;    // the row of that element at which the last chunk begins
+    };
+
+    /*
+     * Push-style counterpart of `PlyStream`, for `PlyFile::read(..., PlyVisitor &, ...)`. The visitor is
+     * handed each batch of rows as it is decoded: `columns` holds one `PlyData` per group requested from
+     * `element`, in the header order of the group's first property, each holding just the `row_count` rows
+     * starting at `row_begin` (see `PlyStream` for their lifetime). Return false to stop reading.
+     */
+    struct PlyVisitor
+    {
+        virtual ~PlyVisitor() {}
+        virtual bool on_element_batch(const PlyElement & element, const std::vector<std::shared_ptr<PlyData>> & columns,
+            const size_t row_begin, const size_t row_count) = 0;
+    };
+
+    /*
+     * Where the time of a `read` went, handed to the sink set with `PlyFile::set_stats_sink`. Phases are
+     * wall time in milliseconds. Elements are listed in header order; those after the last one with
+     * requested properties are never read and stay empty. In parallel reads, an element's `decode_ms`
+     * is summed over the threads that decoded it.
+     */
+    struct PlyReadStats
+    {
+        struct Element
+        {
+            std::string name;
+            size_t rows_decoded{ 0 };   // rows of an element with requested properties
+            uint64_t bytes_read{ 0 };    // payload bytes of an element with requested properties
+            uint64_t bytes_skipped{ 0 }; // payload bytes of an element without, walked past
+            double decode_ms{ 0 };
+        };
+        double header_ms{ 0 };   // `parse_header`, or matching the header of `read_next`
+        double setup_ms{ 0 };    // compiling the requests, applying the sidecar index and allocating buffers
+        double decode_ms{ 0 };   // the single pass over the payload
+        double swap_ms{ 0 };     // byte-swapping big-endian groups that were not swapped while being decoded
+        double finish_ms{ 0 };   // trimming grown buffers and saving the sidecar index
+        double total_ms{ 0 };    // the whole `read`, excluding the header
+        size_t allocations{ 0 }; // buffers allocated, from the heap or the arena
+        uint64_t bytes_allocated{ 0 };
+        std::vector<Element> elements;
+    };
+
     struct PlyFile
     {
         struct PlyFileImpl;
@@ -133,37 +367,221 @@ namespace tinyply
          */
         bool parse_header(std::istream & is);
 
+        /*
+         * Identical to `parse_header(std::istream &)`, but parses from a contiguous block of memory
+         * holding the whole file (beginning with the "ply" magic). The same block must later be
+         * passed to `read(const uint8_t *, size_t)`.
+         */
+        bool parse_header(const uint8_t * data, const size_t size);
+
         /*
          * Execute a read operation. Data must be requested via `request_properties_from_element(...)`
          * prior to calling this function.
          */
         void read(std::istream & is);
 
+        /*
+         * Execute a read operation directly from memory; `data` and `size` describe the entire file,
+         * exactly as passed to `parse_header(const uint8_t *, size_t)`. All reads are bounds-checked
+         * against `size`. For binary files that do not need an endian swap, a property group which
+         * covers every property of a list-free element is not copied: its `PlyData::buffer` becomes a
+         * non-owning view into `data`, which must then outlive the returned `PlyData`.
+         */
+        void read(const uint8_t * data, const size_t size);
+
+        /*
+         * Identical to `read(...)`, but decoding is spread over `thread_count` threads (0 picks the hardware
+         * concurrency). In binary files held in memory, elements whose offsets are known up front (from the
+         * header, or the sidecar index) are decoded concurrently, and list-free elements are further split into
+         * ranges of rows. Binary streams are read serially. List-free elements of ascii files are split into
+         * ranges of rows as well, located by scanning for newlines, so an element is only split up if every
+         * row sits on exactly one line; otherwise it is parsed serially. The ascii stream variant first reads
+         * the remaining payload into memory. The last variant reads the file opened with `open_mapped(...)`.
+         */
+        void read_parallel(std::istream & is, const size_t thread_count = 0);
+        void read_parallel(const uint8_t * data, const size_t size, const size_t thread_count = 0);
+        void read_parallel(const size_t thread_count);
+
+        /*
+         * Memory-maps the file at `path` (mmap on POSIX, MapViewOfFile on Windows) and parses the
+         * header from the mapping. Element data is then served straight out of the mapped pages by
+         * `read()`, so only the pages backing requested properties are faulted in. Views handed back
+         * by the zero-copy path keep the mapping alive on their own. Throws if the file cannot be
+         * mapped; otherwise returns the result of `parse_header`.
+         */
+        bool open_mapped(const std::string & path);
+
+        /*
+         * Execute a read operation on the file previously opened with `open_mapped(...)`.
+         */
+        void read();
+
+        /*
+         * Decodes only the rows [row_begin, row_begin + row_count) of a binary element into the properties
+         * requested from it, which afterwards hold `row_count` rows each; no other element is read. The first
+         * row is sought straight to when its offset follows from the header (list-free elements), or from the
+         * sidecar index (see `use_sidecar_index`), whose checkpoints leave at most a few thousand rows of lists
+         * to be skipped over. Otherwise whatever lies in front of the rows is walked without being decoded,
+         * and the element offsets learned along the way serve the next call. Windows of the same file may be
+         * read repeatedly, e.g. as tiles. The first variant reads the file opened with `open_mapped(...)`; the
+         * second the entire file in memory, as for `read(const uint8_t *, size_t)`, with the same zero-copy
+         * views; the third a seekable stream positioned anywhere, which holds the entire file from offset 0.
+         * Throws for ascii files, unknown elements and windows beyond the end of the element.
+         */
+        void read_range(const std::string & elementKey, const size_t row_begin, const size_t row_count);
+        void read_range(const uint8_t * data, const size_t size, const std::string & elementKey, const size_t row_begin, const size_t row_count);
+        void read_range(std::istream & is, const std::string & elementKey, const size_t row_begin, const size_t row_count);
+
+        /*
+         * Reads the next file of a batch whose headers all match the one parsed by this `PlyFile`, save for
+         * their element counts and comments. Only that much of the header is checked and parsed; everything
+         * derived from the header and the requests is reused, and the results land in the same `PlyData`
+         * as before, replacing those of the previous file. Buffers that tinyply allocated are reused when
+         * large enough (or come from the arena; see `use_arena`). Returns false if the header does not match,
+         * in which case nothing was read; a stream is then left somewhere within the header. A sidecar index
+         * only ever applies to the file it was opened for. The variants mirror those of `read`.
+         */
+        bool read_next(std::istream & is);
+        bool read_next(const uint8_t * data, const size_t size);
+
+        /*
+         * Begins streaming the payload in bounded chunks instead of reading it in one go; see `PlyStream`.
+         * Properties must be requested beforehand, exactly as for `read`, and this `PlyFile` (as well as
+         * the stream or memory) must outlive the returned cursor. The variants mirror those of `read`.
+         */
+        PlyStream begin_stream(std::istream & is);
+        PlyStream begin_stream(const uint8_t * data, const size_t size);
+        PlyStream begin_stream();
+
+        /*
+         * Reads with a `PlyVisitor`, which receives every requested element in batches of up to `batch_rows`
+         * rows rather than in whole buffers. Returns false if the visitor stopped the read early, which
+         * leaves the rest of the payload unread. The variants mirror those of `read`.
+         */
+        bool read(std::istream & is, PlyVisitor & visitor, const size_t batch_rows = 65536);
+        bool read(const uint8_t * data, const size_t size, PlyVisitor & visitor, const size_t batch_rows = 65536);
+        bool read(PlyVisitor & visitor, const size_t batch_rows = 65536);
+
         /*
          * `write` performs no validation and assumes that the data passed into
          * `add_properties_to_element` is well-formed.
          */
         void write(std::ostream & os, bool isBinary);
 
+        /*
+         * Identical to `write(...)`, but rows are encoded on `thread_count` threads (0 picks the hardware
+         * concurrency). Large elements are cut into ranges of rows that are each formatted into a block of
+         * their own, and the blocks are written to `os` in order, so the output is byte-identical to `write`.
+         * This pays off for ascii output and for binary elements gathered from several property groups; an
+         * element stored as one group in file order is still written straight from its buffer.
+         */
+        void write_parallel(std::ostream & os, bool isBinary, const size_t thread_count = 0);
+
+        /*
+         * By default, ascii `write`s emit every float with a shortest-form digit string that reads back
+         * to the identical value (Grisu2; a rare double gets one digit more than needed). A `decimals` of
+         * 0 to 17 instead writes exactly that many digits after the decimal point, which is faster and
+         * smaller but lossy. Pass -1 to restore the default.
+         */
+        void set_ascii_precision(const int decimals);
+
+        /*
+         * Binary `write`s are little-endian by default. With `true`, they produce `binary_big_endian` files
+         * instead: rows are byte-swapped while they are staged for writing, never in the buffers passed to
+         * `add_properties_to_element`.
+         */
+        void set_big_endian(const bool bigEndian);
+
+        /*
+         * Allocates the buffers of later reads (and streams) from `arena` rather than from the heap; pass
+         * nullptr to go back to the heap. Buffers keep the arena itself alive, but only hold valid data
+         * until the arena is `reset()`, so copy out what is needed beyond that. One arena may be shared
+         * by many files that are read one after another.
+         */
+        void use_arena(std::shared_ptr<PlyArena> arena);
+
+        /*
+         * Opts into read statistics: after every `read` that fills whole buffers (in memory, from a stream,
+         * mapped, `read_next` and `read_parallel` alike), `sink` receives a `PlyReadStats` for it. Without a
+         * sink nothing is measured; the cost is then one check per element. Pass an empty function to stop.
+         */
+        void set_stats_sink(std::function<void(const PlyReadStats &)> sink);
+
         /*
          * These functions are valid after a call to `parse_header(...)`. In the case of
          * writing, get_comments() reference may also be used to add new comments to the ply header.
          */
         std::vector<PlyElement> get_elements() const;
+
+        /*
+         * The absolute byte offset (from the start of the file) at which each element's data begins,
+         * parallel to `get_elements()`. For binary files, offsets are computed from the header for every
+         * element up to and including the first one that contains list properties; the remainder are
+         * -1 until a `read` has walked past them. For ascii files, only the first offset is known up front.
+         */
+        std::vector<int64_t> get_element_offsets() const;
+
+        /*
+         * Opts into a persistent sidecar index for the file at `plyPath`, stored next to it as
+         * `plyPath + ".idx"`. Call after `parse_header(...)` and before `read(...)`. If a valid index
+         * exists (matching file size, modification time and header), `read` uses the recorded list
+         * lengths to allocate exactly, rather than growing list buffers while reading.
+         * Otherwise, the index is (re)written once `read` completes. It also records the offset of
+         * every `index_checkpoint_rows`-th row of elements containing lists. Returns true if a valid
+         * index was loaded.
+         */
+        bool use_sidecar_index(const std::string & plyPath);
+
+        // Rows between the offsets that a sidecar index records for an element containing lists
+        static const size_t index_checkpoint_rows = 4096;
+
         std::vector<std::string> get_info() const;
         std::vector<std::string> & get_comments();
         bool is_binary_file() const;
 
         /*
-         * In the general case where |list_size_hint| is zero, `read` performs a two-pass
-         * parse to support variable length lists. The most general use of the
-         * ply format is storing triangle meshes. When this fact is known a-priori, we can pass
-         * an expected list length that will apply to this element. Doing so results in an up-front
-         * memory allocation and a single-pass import, a 2x performance optimization.
+         * `read` is always a single pass over the file, so any stream will do, pipes and sockets
+         * included. Buffers of variable length lists are grown as the lists are read, then trimmed.
+         * The most general use of the ply format is storing triangle meshes. When this fact is known
+         * a-priori, we can pass an expected list length that will apply to this element; it sizes the
+         * up-front allocation so that the buffer rarely needs to grow.
          */
         std::shared_ptr<PlyData> request_properties_from_element(const std::string & elementKey,
             const std::vector<std::string> propertyKeys, const uint32_t list_size_hint = 0);
 
+        /*
+         * Identical to the above, but every value of the group is converted to `targetType` as it is
+         * read, so its properties need not share a type: e.g. {"x", "y", "z"} stored as doubles can be
+         * read as floats, or {"red", "green", "blue"} stored as uchar as floats. Values convert as by
+         * static_cast, except that floating-point values bound for an integer type are clamped to its
+         * range. The returned `PlyData::t` is `targetType`.
+         */
+        std::shared_ptr<PlyData> request_properties_from_element(const std::string & elementKey,
+            const std::vector<std::string> propertyKeys, const Type targetType, const uint32_t list_size_hint = 0);
+
+        /*
+         * Identical to the above, but `read` decodes the properties straight into `destination` rather
+         * than into a buffer of its own; the returned `PlyData::buffer` is a non-owning view of it. The
+         * properties of each row are written next to each other, in the order they appear in the header,
+         * and consecutive rows are `stride` bytes apart (0 packs them). A non-zero stride places a group
+         * inside an array of structs, e.g. {"x", "y", "z"} into `&vertices[0].position` with a stride of
+         * `sizeof(Vertex)`. Lists can only be read packed. Throws if `capacity` (bytes, counted from
+         * `destination`) cannot hold the element; for lists this is checked as they are read. A valid
+         * `targetType` converts the group as above; the row layout is then that of the converted values.
+         */
+        std::shared_ptr<PlyData> request_properties_from_element(const std::string & elementKey,
+            const std::vector<std::string> propertyKeys, uint8_t * destination, const size_t capacity, const size_t stride = 0,
+            const Type targetType = Type::INVALID);
+
+        /*
+         * Requests every one of `propertyKeys` into a column of its own (structure of arrays), where
+         * `request_properties_from_element` interleaves a group into one buffer (array of structs). `read`
+         * still decodes each row once, scattering its values across the columns. Columns are allocated like
+         * any other buffer, aligned to `Buffer::alignment`. A valid `targetType` converts every column to it.
+         */
+        std::vector<std::shared_ptr<PlyData>> request_columns_from_element(const std::string & elementKey,
+            const std::vector<std::string> propertyKeys, const Type targetType = Type::INVALID, const uint32_t list_size_hint = 0);
+
         void add_properties_to_element(const std::string & elementKey,
             const std::vector<std::string> propertyKeys,
             const Type type,
@@ -171,8 +589,127 @@ namespace tinyply
             const uint8_t * data,
             const Type listType,
             const size_t listCount);
+
+        /*
+         * Adds a list property whose lists may differ in length, laid out as `PlyData` returns them: the
+         * values of all `count` rows back to back in `data`, and `count + 1` offsets (in values) into it.
+         * Neither array is copied; both must stay alive until the file has been written.
+         */
+        void add_list_property_to_element(const std::string & elementKey, const std::string & propertyKey,
+            const Type type, const size_t count, const uint8_t * data, const Type listType, const uint32_t * offsets);
+        void add_list_property_to_element(const std::string & elementKey, const std::string & propertyKey,
+            const Type type, const size_t count, const uint8_t * data, const Type listType, const uint64_t * offsets);
+    };
+
+    /*
+     * Codecs for `PlyDecompressingStream` and `PlyCompressingStream`. tinyply itself depends on no
+     * compression library: implement these over zstd, LZ4 or the like, or build with `TINYPLY_WITH_ZLIB`
+     * (and link zlib) for the gzip codecs below. Each codec is only ever called from one thread at a time.
+     */
+    struct PlyDecompressor
+    {
+        virtual ~PlyDecompressor() {}
+        virtual size_t decompress(uint8_t * out, const size_t capacity) = 0; // bytes written to `out`, 0 at the end
+    };
+
+    struct PlyCompressor
+    {
+        virtual ~PlyCompressor() {}
+        virtual void compress(const uint8_t * data, const size_t size) = 0; // consumes all of `data`
+        virtual void finish() = 0; // after the last `compress`
+    };
+
+    /*
+     * An input stream of decompressed bytes, to pass to `PlyFile::parse_header` and `read` in place of the
+     * compressed file. A background thread decompresses ahead of the parser into a ring of `ring_blocks`
+     * blocks of `block_bytes` each, so decompression and parsing overlap. The stream cannot seek, which every
+     * read path handles in a single pass; a list size hint or the sidecar index only saves buffer growth.
+     * Errors of the codec are rethrown by the read that runs into them.
+     */
+    class PlyDecompressingStream : public std::istream
+    {
+        struct Impl;
+        std::unique_ptr<Impl> impl;
+    public:
+        explicit PlyDecompressingStream(std::unique_ptr<PlyDecompressor> codec, const size_t block_bytes = size_t(1) << 20, const size_t ring_blocks = 4);
+        ~PlyDecompressingStream();
+    };
+
+    /*
+     * Reads the (uncompressed) file at `path` on a dedicated I/O thread, which keeps up to `ring_blocks`
+     * blocks of `block_bytes` read ahead of the parser, so that disk reads overlap with decoding. Blocks
+     * are read whole, straight into the ring (aligned to `Buffer::alignment`), with the kernel told to
+     * expect a sequential scan. This is not zero-copy: like any stream, it is decoded through
+     * `std::istream::read`, which copies each block out of the ring. For files larger than the page
+     * cache this is the alternative to `open_mapped`, which only faults pages in as the decoder reaches
+     * them. Throws if the file cannot be opened.
+     */
+    class PlyPrefetchingStream : public PlyDecompressingStream
+    {
+    public:
+        explicit PlyPrefetchingStream(const std::string & path, const size_t block_bytes = size_t(4) << 20, const size_t ring_blocks = 4);
+    };
+
+    /*
+     * The writing counterpart: pass it to `PlyFile::write`, then `close()` it. Written bytes are gathered
+     * into blocks of `block_bytes`, and a background thread compresses up to `ring_blocks` of them while
+     * the next ones are written. `close()` flushes, waits for the compressor, finishes it and rethrows its
+     * errors; the destructor closes too, but swallows them.
+     */
+    class PlyCompressingStream : public std::ostream
+    {
+        struct Impl;
+        std::unique_ptr<Impl> impl;
+    public:
+        explicit PlyCompressingStream(std::unique_ptr<PlyCompressor> codec, const size_t block_bytes = size_t(1) << 20, const size_t ring_blocks = 4);
+        ~PlyCompressingStream();
+        void close();
+    };
+
+#if defined(TINYPLY_WITH_ZLIB)
+    // gzip (or zlib) data read from `compressed`; concatenated gzip members are read one after another
+    class PlyGzipDecompressor : public PlyDecompressor
+    {
+        struct State;
+        std::unique_ptr<State> state;
+    public:
+        explicit PlyGzipDecompressor(std::istream & compressed);
+        ~PlyGzipDecompressor();
+        size_t decompress(uint8_t * out, const size_t capacity) override;
+    };
+
+    // gzip data written to `compressed`, at zlib's `level` (1 fastest to 9 smallest)
+    class PlyGzipCompressor : public PlyCompressor
+    {
+        struct State;
+        std::unique_ptr<State> state;
+    public:
+        explicit PlyGzipCompressor(std::ostream & compressed, const int level = 6);
+        ~PlyGzipCompressor();
+        void compress(const uint8_t * data, const size_t size) override;
+        void finish() override;
+    };
+#endif
+
+    // A named `PlyData`, as exported by `export_arrow`
+    struct PlyColumn
+    {
+        std::string name;
+        std::shared_ptr<PlyData> data;
     };
 
+    /*
+     * Exports `columns` as one record batch through the Arrow C data interface, to be imported on the other
+     * side by e.g. `arrow::ImportRecordBatch(array, schema)`: a struct array of one non-nullable child per
+     * column, all of which must hold the same number of rows. The memory of every buffer moves into the
+     * array without a copy (see `Buffer::release`) and is freed by its release callback; the `PlyData` are
+     * left empty, and a later read into them allocates anew. A column becomes a primitive array if it holds
+     * one value per row, a fixed_size_list for a group of several (such as {"x", "y", "z"}), and a list, or
+     * large_list for 64-bit offsets, if it holds lists. Throws `std::invalid_argument`, exporting nothing,
+     * for columns that do not fit these shapes, such as values read into a strided caller array.
+     */
+    void export_arrow(const std::vector<PlyColumn> & columns, ArrowSchema * schema, ArrowArray * array);
+
 } // end namespace tinyply
 
 #endif // end tinyply_h
@@ -187,7 +724,54 @@ namespace tinyply
 #include <functional>
 #include <type_traits>
 #include <iostream>
+#include <fstream>
 #include <cstring>
+#include <cctype>
+#include <limits>
+#include <locale>
+#include <cmath>
+#include <iterator>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <chrono>
+#include <condition_variable>
+
+#if defined(TINYPLY_WITH_ZLIB)
+    #include <zlib.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define TINYPLY_SWAP_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+        #define TINYPLY_TARGET(isa)
+    #else
+        #define TINYPLY_TARGET(isa) __attribute__((target(isa)))
+    #endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define TINYPLY_SWAP_NEON 1
+    #include <arm_neon.h>
+#endif
+
+#if defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
 
 namespace tinyply
 {
@@ -214,759 +798,3996 @@ template<> inline int64_t endian_swap<int64_t, int64_t>(const int64_t & v) noexc
 template<> inline float endian_swap<uint32_t, float>(const uint32_t & v) noexcept { union { float f; uint32_t i; }; i = endian_swap<uint32_t, uint32_t>(v); return f; }
 template<> inline double endian_swap<uint64_t, double>(const uint64_t & v) noexcept { union { double d; uint64_t i; }; i = endian_swap<uint64_t, uint64_t>(v); return d; }
 
-inline uint32_t hash_fnv1a(const std::string & str) noexcept
+inline Type property_type_from_string(const char * first, const char * last) noexcept
 {
-    static const uint32_t fnv1aBase32 = 0x811C9DC5u;
-    static const uint32_t fnv1aPrime32 = 0x01000193u;
-    uint32_t result = fnv1aBase32;
-    for (auto & c : str) { result ^= static_cast<uint32_t>(c); result *= fnv1aPrime32; }
-    return result;
+    struct Name { const char * text; size_t length; Type t; };
+    static const Name names[] = {
+        { "int8", 4, Type::INT8 }, { "char", 4, Type::INT8 }, { "uint8", 5, Type::UINT8 }, { "uchar", 5, Type::UINT8 },
+        { "int16", 5, Type::INT16 }, { "short", 5, Type::INT16 }, { "uint16", 6, Type::UINT16 }, { "ushort", 6, Type::UINT16 },
+        { "int32", 5, Type::INT32 }, { "int", 3, Type::INT32 }, { "uint32", 6, Type::UINT32 }, { "uint", 4, Type::UINT32 },
+        { "float32", 7, Type::FLOAT32 }, { "float", 5, Type::FLOAT32 }, { "float64", 7, Type::FLOAT64 }, { "double", 6, Type::FLOAT64 } };
+    const size_t length = static_cast<size_t>(last - first);
+    for (auto & n : names) if (n.length == length && std::memcmp(n.text, first, length) == 0) return n.t;
+    return Type::INVALID;
 }
 
 inline Type property_type_from_string(const std::string & t) noexcept
 {
-    if (t == "int8" || t == "char")           return Type::INT8;
-    else if (t == "uint8" || t == "uchar")    return Type::UINT8;
-    else if (t == "int16" || t == "short")    return Type::INT16;
-    else if (t == "uint16" || t == "ushort")  return Type::UINT16;
-    else if (t == "int32" || t == "int")      return Type::INT32;
-    else if (t == "uint32" || t == "uint")    return Type::UINT32;
-    else if (t == "float32" || t == "float")  return Type::FLOAT32;
-    else if (t == "float64" || t == "double") return Type::FLOAT64;
-    return Type::INVALID;
+    return property_type_from_string(t.data(), t.data() + t.size());
 }
 
-struct PlyFile::PlyFileImpl
+// A read-only mapping of an entire file. The file handle is only held as long as needed to
+// establish the mapping; the mapping itself lives until the last reference is released.
+struct MappedFile
 {
-    struct PlyDataCursor
+    const uint8_t * data{ nullptr };
+    size_t size{ 0 };
+#if defined(_WIN32)
+    HANDLE mapping{ nullptr };
+#endif
+
+    explicit MappedFile(const std::string & path)
     {
-        size_t byteOffset{ 0 };
-        size_t totalSizeBytes{ 0 };
-    };
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("could not open file for mapping: " + path);
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size)) { CloseHandle(file); throw std::runtime_error("could not stat file for mapping: " + path); }
+        size = static_cast<size_t>(file_size.QuadPart);
+        if (size > 0)
+        {
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) data = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+        CloseHandle(file);
+        if (size > 0 && !data) { if (mapping) CloseHandle(mapping); throw std::runtime_error("could not map file: " + path); }
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("could not open file for mapping: " + path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0) { ::close(fd); throw std::runtime_error("could not stat file for mapping: " + path); }
+        size = static_cast<size_t>(st.st_size);
+        if (size > 0)
+        {
+            void * ptr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr == MAP_FAILED) { ::close(fd); throw std::runtime_error("could not map file: " + path); }
+            data = static_cast<const uint8_t *>(ptr);
+            ::madvise(ptr, size, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+#endif
+    }
 
-    struct ParsingHelper
+    ~MappedFile()
     {
-        std::shared_ptr<PlyData> data;
-        std::shared_ptr<PlyDataCursor> cursor;
-        uint32_t list_size_hint;
-    };
+#if defined(_WIN32)
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+#else
+        if (data) ::munmap(const_cast<uint8_t *>(data), size);
+#endif
+    }
 
-    struct PropertyLookup
+    // Asks the kernel to start paging in a range we are about to decode
+    void will_need(const uint8_t * ptr, const size_t n) const
     {
-        ParsingHelper * helper{ nullptr };
-        bool skip{ false };
-        size_t prop_stride{ 0 }; // precomputed
-        size_t list_stride{ 0 }; // precomputed
-    };
+#if !defined(_WIN32)
+        static const uintptr_t page_mask = ~static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE) - 1);
+        uint8_t * page = reinterpret_cast<uint8_t *>(reinterpret_cast<uintptr_t>(ptr) & page_mask);
+        if (n > 0) ::madvise(page, n + (ptr - page), MADV_WILLNEED);
+#else
+        (void) ptr; (void) n;
+#endif
+    }
 
-    std::unordered_map<uint32_t, ParsingHelper> userData;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator=(const MappedFile &) = delete;
+};
 
-    bool isBinary = false;
-    bool isBigEndian = false;
-    std::vector<PlyElement> elements;
-    std::vector<std::string> comments;
-    std::vector<std::string> objInfo;
-    uint8_t scratch[64]; // large enough for max list size
+// The C locale's whitespace; ascii payloads are tokenized on these alone
+inline bool is_ascii_space(const uint8_t c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
 
-    void read(std::istream & is);
-    void write(std::ostream & os, bool isBinary);
+// The binary payload, as seen by the parser. It is either a span of memory, in which case
+// bytes are handed out in place, or an istream, in which case each request is satisfied by
+// a single `is.read` into a reusable window. Both are bounds-checked and throw on EOF.
+// Ascii payloads are instead tokenized in place; a stream is then read ahead into the window
+// in `text_read_bytes` blocks and `cursor` / `end` walk the window as they would a span.
+struct ByteSource
+{
+    static const size_t text_read_bytes = 1 << 16;
 
-    std::shared_ptr<PlyData> request_properties_from_element(const std::string & elementKey,
-        const std::vector<std::string> propertyKeys,
-        const uint32_t list_size_hint);
+    std::istream * is{ nullptr };
+    const uint8_t * begin{ nullptr };
+    const uint8_t * cursor{ nullptr };
+    const uint8_t * end{ nullptr };
+    std::vector<uint8_t> window;
+    std::shared_ptr<const MappedFile> mapping; // set when the span is a file mapping
+    std::streampos origin{ -1 };               // stream position of the payload, -1 if the stream cannot seek
+    size_t position{ 0 };                      // bytes consumed from a stream through take/skip
+    size_t window_origin{ 0 };                 // payload offset of `window[0]` while tokenizing a stream
+    bool buffered{ false };                    // set once a stream has been read ahead for tokenizing
 
-    void add_properties_to_element(const std::string & elementKey,
-        const std::vector<std::string> propertyKeys,
-        const Type type, const size_t count, const uint8_t * data, const Type listType, const size_t listCount);
+    explicit ByteSource(std::istream & _is) : is(&_is), origin(_is.tellg()) {}
+    ByteSource(const uint8_t * data, const size_t size) : begin(data), cursor(data), end(data + size) {}
 
-    size_t read_property_binary(const size_t & stride, void * dest, size_t & destOffset, size_t destSize, std::istream & is);
-    size_t read_property_ascii(const Type & t, const size_t & stride, void * dest, size_t & destOffset, size_t destSize, std::istream & is);
+    bool is_span() const { return is == nullptr; }
+    bool is_seekable() const { return !is || origin != std::streampos(-1); }
 
-    std::vector<std::vector<PropertyLookup>> make_property_lookup_table();
+    // Paging hint for the next `n` bytes; only meaningful for mapped files
+    void will_need(const size_t n) const
+    {
+        if (mapping) mapping->will_need(cursor, std::min(n, static_cast<size_t>(end - cursor)));
+    }
 
-    bool parse_header(std::istream & is);
-    void parse_data(std::istream & is, bool firstPass);
-    void read_header_format(std::istream & is);
-    void read_header_element(std::istream & is);
-    void read_header_property(std::istream & is);
-    void read_header_text(std::string line, std::vector<std::string> & place, int erase = 0);
+    const uint8_t * take(const size_t n)
+    {
+        if (is)
+        {
+            if (window.size() < n) window.resize(n);
+            position += n;
+            is->read(reinterpret_cast<char *>(window.data()), n);
+            if (static_cast<size_t>(is->gcount()) != n) throw std::runtime_error("unexpected EOF. malformed file?");
+            return window.data();
+        }
+        if (static_cast<size_t>(end - cursor) < n) throw std::runtime_error("unexpected EOF. malformed file?");
+        const uint8_t * ptr = cursor;
+        cursor += n;
+        return ptr;
+    }
 
-    void write_header(std::ostream & os) noexcept;
-    void write_ascii_internal(std::ostream & os) noexcept;
-    void write_binary_internal(std::ostream & os) noexcept;
-    void write_property_ascii(Type t, std::ostream & os, const uint8_t * src, size_t & srcOffset);
-    void write_property_binary(std::ostream & os, const uint8_t * src, size_t & srcOffset, const size_t & stride) noexcept;
-};
+    void skip(const size_t n)
+    {
+        if (is)
+        {
+            position += n;
+            // Large skips seek past the data (when possible) instead of reading it
+            if (n >= 65536 && is_seekable())
+            {
+                is->seekg(static_cast<std::streamoff>(n), std::ios::cur);
+                if (is->fail()) throw std::runtime_error("unexpected EOF. malformed file?");
+                return;
+            }
+            is->ignore(n);
+            if (static_cast<size_t>(is->gcount()) != n) throw std::runtime_error("unexpected EOF. malformed file?");
+            return;
+        }
+        if (static_cast<size_t>(end - cursor) < n) throw std::runtime_error("unexpected EOF. malformed file?");
+        cursor += n;
+    }
 
-PlyProperty::PlyProperty(std::istream & is) : isList(false)
-{
-    std::string type;
-    is >> type;
-    if (type == "list")
+    // Moves the unread tail of the window, starting at `keep`, to its front and appends the next
+    // block of the stream. Pointers into the window are rebased. False once nothing more arrives.
+    bool refill(const uint8_t *& keep)
     {
-        std::string countType;
-        is >> countType >> type;
-        listType = property_type_from_string(countType);
-        isList = true;
+        if (!is) return false;
+        const size_t consumed = buffered ? static_cast<size_t>(keep - window.data()) : 0;
+        const size_t kept = buffered ? static_cast<size_t>(end - keep) : 0;
+        const size_t cursor_offset = buffered ? static_cast<size_t>(cursor - keep) : 0;
+        if (window.size() < kept + text_read_bytes) window.resize(kept + text_read_bytes);
+        std::memmove(window.data(), window.data() + consumed, kept);
+        is->read(reinterpret_cast<char *>(window.data()) + kept, text_read_bytes);
+        const size_t got = static_cast<size_t>(is->gcount());
+        window_origin += consumed;
+        buffered = true;
+        keep = window.data();
+        cursor = keep + cursor_offset;
+        end = keep + kept + got;
+        return got > 0;
     }
-    propertyType = property_type_from_string(type);
-    is >> name;
-}
 
-PlyElement::PlyElement(std::istream & is)
-{
-    is >> name >> size;
-}
+    // The next whitespace-delimited token of an ascii payload; false at the end of the data
+    bool next_token(const char *& first, const char *& last)
+    {
+        for (;;)
+        {
+            while (cursor < end && is_ascii_space(*cursor)) ++cursor;
+            if (cursor < end) break;
+            const uint8_t * keep = cursor;
+            if (!refill(keep)) return false;
+        }
+        const uint8_t * token = cursor;
+        for (;;)
+        {
+            while (cursor < end && !is_ascii_space(*cursor)) ++cursor;
+            if (cursor < end || !refill(token)) break;
+        }
+        first = reinterpret_cast<const char *>(token);
+        last = reinterpret_cast<const char *>(cursor);
+        return true;
+    }
 
-template<typename T> inline T ply_read_ascii(std::istream & is)
-{
-    T data;
-    is >> data;
-    return data;
-}
+    void skip_tokens(const size_t n)
+    {
+        const char * first, * last;
+        for (size_t i = 0; i < n; ++i) if (!next_token(first, last)) throw std::runtime_error("unexpected EOF. malformed file?");
+    }
 
-template<typename T, typename T2>
-inline void endian_swap_buffer(uint8_t * data_ptr, const size_t num_bytes, const size_t stride)
-{
-    for (size_t count = 0; count < num_bytes; count += stride)
+    // Offset from the start of the payload
+    size_t tell() const
     {
-        *(reinterpret_cast<T2 *>(data_ptr)) = endian_swap<T, T2>(*(reinterpret_cast<const T *>(data_ptr)));
-        data_ptr += stride;
+        if (!is) return static_cast<size_t>(cursor - begin);
+        if (buffered) return window_origin + static_cast<size_t>(cursor - window.data());
+        return position;
     }
-}
 
-template<typename T> void ply_cast_ascii(void * dest, std::istream & is)
+    void seek(const size_t pos)
+    {
+        if (is)
+        {
+            if (!is_seekable()) throw std::runtime_error("cannot seek within a non-seekable stream");
+            is->clear();
+            is->seekg(origin + static_cast<std::streamoff>(pos));
+            position = pos;
+            if (buffered)
+            {
+                window_origin = pos;
+                cursor = end = window.data();
+            }
+        }
+        else cursor = begin + pos;
+    }
+};
+
+// Strided gather with a compile-time copy width, which lets the compiler turn each
+// memcpy into plain loads and stores (and vectorize the loop where it can).
+template<size_t N>
+inline void copy_strided(uint8_t * out, const size_t out_stride, const uint8_t * in, const size_t in_stride, const size_t count) noexcept
 {
-    *(static_cast<T *>(dest)) = ply_read_ascii<T>(is);
+    for (size_t i = 0; i < count; ++i, in += in_stride, out += out_stride) std::memcpy(out, in, N);
 }
 
-int64_t find_element(const std::string & key, const std::vector<PlyElement> & list)
+inline void copy_strided(uint8_t * out, const size_t out_stride, const uint8_t * in, const size_t in_stride, const size_t count, const size_t width) noexcept
 {
-    for (size_t i = 0; i < list.size(); i++) if (list[i].name == key) return i;
-    return -1;
+    switch (width)
+    {
+    case 1:  copy_strided<1>(out, out_stride, in, in_stride, count);  break;
+    case 2:  copy_strided<2>(out, out_stride, in, in_stride, count);  break;
+    case 3:  copy_strided<3>(out, out_stride, in, in_stride, count);  break;
+    case 4:  copy_strided<4>(out, out_stride, in, in_stride, count);  break;
+    case 8:  copy_strided<8>(out, out_stride, in, in_stride, count);  break;
+    case 12: copy_strided<12>(out, out_stride, in, in_stride, count); break;
+    case 16: copy_strided<16>(out, out_stride, in, in_stride, count); break;
+    case 24: copy_strided<24>(out, out_stride, in, in_stride, count); break;
+    default: for (size_t i = 0; i < count; ++i, in += in_stride, out += out_stride) std::memcpy(out, in, width); break;
+    }
 }
 
-int64_t find_property(const std::string & key, const std::vector<PlyProperty> & list)
+// Output is accumulated in a large block and handed to the ostream one block at a time.
+// Formatters reserve room for what they may write, then commit what they actually wrote.
+struct BlockWriter
 {
-    for (size_t i = 0; i < list.size(); ++i) if (list[i].name == key) return i;
-    return -1;
+    static const size_t block_bytes = 1 << 20;
+
+    std::ostream * os{ nullptr };
+    std::vector<char> block;
+    size_t used{ 0 };
+
+    explicit BlockWriter(std::ostream & _os) : os(&_os), block(block_bytes) {}
+
+    // Without a stream, everything written is kept in `block`, which grows as needed
+    BlockWriter() : block(block_bytes) {}
+
+    char * reserve(const size_t n)
+    {
+        if (block.size() - used < n && os) flush();
+        if (block.size() - used < n) block.resize(std::max(block.size() * 2, used + n));
+        return block.data() + used;
+    }
+
+    void commit(const char * ptr) { used = static_cast<size_t>(ptr - block.data()); }
+    void put(const char c) { *reserve(1) = c; ++used; }
+
+    void flush()
+    {
+        if (!os) return;
+        os->write(block.data(), used);
+        used = 0;
+    }
+};
+
+struct WriteColumn;
+
+// Buffers allocated for a read, counted for `PlyReadStats` from every thread of a parallel read
+struct AllocationCounter
+{
+    std::atomic<size_t> allocations{ 0 };
+    std::atomic<uint64_t> bytes{ 0 };
+    void add(const size_t n) { ++allocations; bytes += n; }
+};
+
+// Milliseconds since `t0`, for `PlyReadStats`
+inline double elapsed_ms(const std::chrono::steady_clock::time_point & t0)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
 }
 
-// The `userData` table is an easy data structure for capturing what data the
-// user would like out of the ply file, but an inner-loop hash lookup is non-ideal.
-// The property lookup table flattens the table down into a 2D array optimized
-// for parsing. The first index is the element, and the second index is the property.
-std::vector<std::vector<PlyFile::PlyFileImpl::PropertyLookup>> PlyFile::PlyFileImpl::make_property_lookup_table()
+struct PlyFile::PlyFileImpl
 {
-    std::vector<std::vector<PropertyLookup>> element_property_lookup;
+    struct PlyDataCursor
+    {
+        size_t byteOffset{ 0 };
+        size_t totalSizeBytes{ 0 };
+    };
 
-    for (auto & element : elements)
+    struct ParsingHelper
     {
-        std::vector<PropertyLookup> lookups;
+        std::shared_ptr<PlyData> data;
+        std::shared_ptr<PlyDataCursor> cursor;
+        uint32_t list_size_hint;
+        size_t stride{ 0 }; // bytes between the rows of a caller-provided destination, 0 if tinyply allocates it
+        bool convert{ false }; // values are converted to `data->t` as they are read
+    };
 
-        for (auto & property : element.properties)
-        {
-            PropertyLookup f;
+    struct PropertyLookup
+    {
+        ParsingHelper * helper{ nullptr };
+        bool skip{ false };
+        size_t prop_stride{ 0 }; // precomputed
+        size_t list_stride{ 0 }; // precomputed
+        size_t dst_stride{ 0 };  // bytes per value in the destination; differs from `prop_stride` when converting
+    };
 
-            auto cursorIt = userData.find(hash_fnv1a(element.name + property.name));
-            if (cursorIt != userData.end()) f.helper = &cursorIt->second;
-            else f.skip = true;
+    // Every requested (or added) property, in request order. A deque keeps each entry in place, since
+    // `requestTable` and the property lookup table point at them.
+    std::deque<ParsingHelper> userData;
+    std::vector<std::vector<ParsingHelper *>> requestTable; // by element index, then property index
+    ParsingHelper * find_request(const size_t element_idx, const size_t property_idx) const;
+    bool insert_request(const size_t element_idx, const size_t property_idx, const ParsingHelper & helper);
 
-            f.prop_stride = PropertyTable[property.propertyType].stride;
-            if (property.isList) f.list_stride = PropertyTable[property.listType].stride;
+    bool isBinary = false;
+    bool isBigEndian = false;
+    bool writeBigEndian = false; // byte order of binary `write`s
+    std::function<void(const PlyReadStats &)> statsSink;
+    std::unique_ptr<PlyReadStats> stats; // of the read in progress; only while there is a sink
+    AllocationCounter allocationCounter;
+    AllocationCounter * allocations() { return stats ? &allocationCounter : nullptr; }
+    size_t payloadOffset{ 0 }; // byte size of the header, i.e. where element data begins
+    std::vector<int64_t> elementOffsets; // absolute byte offset of each element, -1 if not (yet) known
 
-            lookups.push_back(f);
-        }
+    // What the sidecar index records about elements with lists
+    struct ListStats
+    {
+        uint64_t total{ 0 }; // sum of list lengths over all rows
+        uint64_t min{ std::numeric_limits<uint64_t>::max() };
+        uint64_t max{ 0 };
+    };
 
-        element_property_lookup.push_back(lookups);
-    }
+    struct ElementIndex
+    {
+        bool complete{ false };             // set once the element has been walked in full
+        std::vector<ListStats> lists;       // per property; unused for non-list properties
+        std::vector<uint64_t> checkpoints;  // absolute offset of every `index_checkpoint_rows`-th row
+    };
 
-    return element_property_lookup;
-}
+    std::vector<ElementIndex> elementIndex;
+    std::string indexPath; // the ply file the sidecar index belongs to; empty if not in use
+    bool indexDirty{ false };
+    std::shared_ptr<const MappedFile> mapping;
+    size_t threadCount{ 1 }; // for `read_parallel` and `write_parallel`
+    std::shared_ptr<PlyArena> arena; // where buffers are allocated, if not on the heap
+    int asciiDecimals{ -1 }; // fixed digits after the point for written ascii floats, -1 for shortest round-trip
+    static const size_t bulk_read_bytes = 1 << 22; // staging size for block reads of list-free elements from streams
+    static const size_t swap_block_bytes = 1 << 17; // bytes of rows decoded per in-cache byte swap of big-endian elements
+    std::vector<PlyElement> elements;
+    std::vector<std::string> comments;
+    std::vector<std::string> objInfo;
 
-bool PlyFile::PlyFileImpl::parse_header(std::istream & is)
+    void read(std::istream & is);
+    void read(const uint8_t * data, const size_t size, std::shared_ptr<const MappedFile> owner = nullptr);
+    void read(ByteSource & src);
+    void read_payload(const uint8_t * payload, const size_t size, std::shared_ptr<const MappedFile> owner);
+    void read_parallel(const uint8_t * data, const size_t size, const size_t thread_count);
+    void read_parallel(std::istream & is, const size_t thread_count);
+    void read_parallel(const size_t thread_count);
+    bool parse_ascii_element_parallel(const PlyElement & element, const std::vector<PropertyLookup> & lookups, ByteSource & src);
+    bool open_mapped(const std::string & path);
+    void read_mapped();
+    void read_range(const std::string & elementKey, const size_t row_begin, const size_t row_count);
+    void read_range(const uint8_t * data, const size_t size, const std::string & elementKey, const size_t row_begin, const size_t row_count);
+    void read_range(std::istream & is, const std::string & elementKey, const size_t row_begin, const size_t row_count);
+    void read_range(ByteSource & src, const std::string & elementKey, const size_t row_begin, const size_t row_count);
+    void seek_row(ByteSource & src, const size_t element_idx, const size_t row);
+    void skip_rows(ByteSource & src, const size_t element_idx, const size_t row_count);
+    void begin_stream(PlyStream::PlyStreamImpl & stream);
+    size_t next_chunk(PlyStream::PlyStreamImpl & stream, const size_t max_rows);
+    bool visit(PlyStream::PlyStreamImpl & stream, PlyVisitor & visitor, const size_t batch_rows);
+    void write(std::ostream & os, bool isBinary);
+    void write_parallel(std::ostream & os, bool isBinary, const size_t thread_count);
+    void set_ascii_precision(const int decimals);
+    void set_big_endian(const bool bigEndian);
+    void set_stats_sink(std::function<void(const PlyReadStats &)> sink);
+
+    std::shared_ptr<PlyData> request_properties_from_element(const std::string & elementKey,
+        const std::vector<std::string> propertyKeys,
+        const uint32_t list_size_hint, const Type targetType);
+    std::shared_ptr<PlyData> request_properties_from_element(const std::string & elementKey,
+        const std::vector<std::string> propertyKeys, uint8_t * destination, const size_t capacity, const size_t stride, const Type targetType);
+    std::vector<std::shared_ptr<PlyData>> request_columns_from_element(const std::string & elementKey,
+        const std::vector<std::string> propertyKeys, const Type targetType, const uint32_t list_size_hint);
+
+    void add_properties_to_element(const std::string & elementKey,
+        const std::vector<std::string> propertyKeys,
+        const Type type, const size_t count, const uint8_t * data, const Type listType, const size_t listCount);
+    void add_list_property_to_element(const std::string & elementKey, const std::string & propertyKey,
+        const Type type, const size_t count, const uint8_t * data, const Type listType, const uint8_t * offsets, const size_t offsetStride);
+
+    size_t read_property_binary(const size_t & stride, void * dest, size_t & destOffset, size_t destSize, ByteSource & src);
+    size_t read_property_ascii(const Type & t, const size_t & stride, void * dest, size_t & destOffset, size_t destSize, ByteSource & src);
+    size_t read_property_converted(const Type from, const Type to, const size_t count, void * dest, size_t & destOffset, size_t destSize, ByteSource & src);
+
+    // One coalesced byte-range copy from a file row into a destination row
+    struct CopyOp
+    {
+        ParsingHelper * helper{ nullptr };
+        size_t src_offset{ 0 }; // within a file row
+        size_t dst_offset{ 0 }; // within a destination row
+        size_t dst_stride{ 0 }; // bytes between destination rows
+        size_t size{ 0 };       // bytes within a file row
+        Type from{ Type::INVALID }; // if set, values are converted from this type to `to` (and byte-swapped) as they are copied
+        Type to{ Type::INVALID };
+    };
+
+    // Where the requested properties of one group land, per row
+    struct Destination
+    {
+        ParsingHelper * helper{ nullptr };
+        size_t row_bytes{ 0 }; // bytes of this group in each row
+        size_t stride{ 0 };    // bytes between rows; larger than `row_bytes` inside a caller's array of structs
+    };
+
+    struct DecodePlan
+    {
+        bool fixed_stride{ false }; // binary and list-free; the ops below are only valid if set
+        size_t row_stride{ 0 };
+        std::vector<CopyOp> ops;
+        std::vector<Destination> destinations;
+    };
+
+    std::vector<std::vector<PropertyLookup>> make_property_lookup_table();
+    std::vector<DecodePlan> make_decode_plan(const std::vector<std::vector<PropertyLookup>> & element_property_lookup);
+
+    // Derived from the header and the requests alone, so every read with the same requests shares them;
+    // see `compile_requests`. Cleared whenever `userData` changes.
+    std::vector<std::vector<PropertyLookup>> lookupTable;
+    std::vector<DecodePlan> decodePlans;
+    void compile_requests();
+
+    // The header as parsed, for `read_next` to match other headers against. Element lines keep only
+    // the text before their count; comments are left out.
+    struct HeaderLine
+    {
+        std::string text;
+        bool element{ false };
+    };
+    std::vector<HeaderLine> headerLines;
+    bool match_header(const char * data, const size_t size, size_t & header_bytes);
+    void start_next_file(const size_t header_bytes);
+    bool read_next(std::istream & is);
+    bool read_next(const uint8_t * data, const size_t size);
+
+    bool parse_header(std::istream & is);
+    bool parse_header(const uint8_t * data, const size_t size);
+    void compute_element_offsets();
+    uint64_t header_hash() const;
+    static bool stat_file(const std::string & path, uint64_t & size, int64_t & mtime);
+    bool load_index();
+    void save_index();
+    bool use_sidecar_index(const std::string & plyPath);
+    bool apply_index();
+    void parse_data(ByteSource & src);
+    void parse_element(const size_t element_idx, ByteSource & src);
+    void note_element(const size_t element_idx, const size_t bytes, const double ms);
+    bool is_aliasable(const DecodePlan & plan) const;
+    size_t read_list_size_binary(const Type & t, const size_t & stride, ByteSource & src);
+    void decode_rows(const DecodePlan & plan, const uint8_t * rows, const size_t row_count, uint8_t * const * dst) noexcept;
+    void decode_fixed_stride_rows(const DecodePlan & plan, ByteSource & src, const size_t row_count);
+    void decode_row_range(const DecodePlan & plan, const uint8_t * rows, const size_t first_row, const size_t row_count);
+    void check_fixed_stride_bounds(const DecodePlan & plan, const size_t row_count) const;
+    size_t decode_binary_elements_parallel(ByteSource & src, const size_t element_end);
+    void parse_rows(PlyElement & element, std::vector<PropertyLookup> & lookups, const DecodePlan & plan,
+        ByteSource & src, const size_t row_count, ElementIndex * index);
+    bool parse_header_text(const char * data, const size_t size);
+    void read_header_format(ByteSource & tokens);
+    void read_header_element(ByteSource & tokens);
+    void read_header_property(ByteSource & tokens);
+    void read_header_text(std::string line, std::vector<std::string> & place, int erase = 0);
+
+    void write_header(std::ostream & os) noexcept;
+    void write_ascii_internal(std::ostream & os) noexcept;
+    void write_binary_internal(std::ostream & os) noexcept;
+    void write_ascii_rows(BlockWriter & out, const std::vector<WriteColumn> & columns, const size_t first_row, const size_t row_count) noexcept;
+    void encode_rows(BlockWriter & out, const size_t rows, const std::function<void(BlockWriter &, size_t, size_t)> & encode) noexcept;
+};
+
+struct PlyStream::PlyStreamImpl
 {
-    std::string line;
-    bool success = true;
-    while (std::getline(is, line))
+    PlyFile::PlyFileImpl * file{ nullptr };
+    ByteSource src;
+    std::vector<std::vector<PlyFile::PlyFileImpl::PropertyLookup>> lookups;
+    std::vector<PlyFile::PlyFileImpl::DecodePlan> plans;
+    std::unordered_map<PlyData *, Buffer> storage; // chunk buffers, reused (and only ever grown) from chunk to chunk
+    size_t element_end{ 0 };     // one past the last requested element
+    size_t element_idx{ 0 };
+    size_t row{ 0 };             // rows of the current element consumed so far
+    size_t chunk_element{ 0 };
+    size_t chunk_first_row{ 0 };
+
+    PlyStreamImpl(PlyFile::PlyFileImpl * _file, const ByteSource & _src) : file(_file), src(_src) {}
+};
+
+const size_t Buffer::alignment;
+
+PlyArena::PlyArena(const size_t _block_size) : block_size(std::max<size_t>(_block_size, 1)) {}
+
+uint8_t * PlyArena::allocate(const size_t bytes)
+{
+    const size_t rounded = (bytes + Buffer::alignment - 1) / Buffer::alignment * Buffer::alignment;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (blocks.empty() || blocks.back().used + rounded > blocks.back().memory.size_bytes())
     {
-        std::istringstream ls(line);
-        std::string token;
-        ls >> token;
-        if (token == "ply" || token == "PLY" || token == "") continue;
-        else if (token == "comment")    read_header_text(line, comments, 8);
-        else if (token == "format")     read_header_format(ls);
-        else if (token == "element")    read_header_element(ls);
-        else if (token == "property")   read_header_property(ls);
-        else if (token == "obj_info")   read_header_text(line, objInfo, 9);
-        else if (token == "end_header") break;
-        else success = false; // unexpected header field
+        // Blocks at least double the reservation, so a large file needs few of them
+        Block block;
+        block.memory = Buffer(std::max(std::max(block_size, rounded), reserved_unlocked()));
+        blocks.push_back(std::move(block));
     }
-    return success;
+    Block & block = blocks.back();
+    uint8_t * ptr = block.memory.get() + block.used;
+    block.used += rounded;
+    return ptr;
 }
 
-void PlyFile::PlyFileImpl::read_header_text(std::string line, std::vector<std::string>& place, int erase)
+void PlyArena::reset()
 {
-    place.push_back((erase > 0) ? line.erase(0, erase) : line);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (blocks.size() > 1)
+    {
+        const size_t reserved = reserved_unlocked();
+        blocks.clear();
+        Block block;
+        block.memory = Buffer(reserved);
+        blocks.push_back(std::move(block));
+    }
+    for (auto & block : blocks) block.used = 0;
 }
 
-void PlyFile::PlyFileImpl::read_header_format(std::istream & is)
+size_t PlyArena::bytes_used() const
 {
-    std::string s;
-    (is >> s);
-    if (s == "binary_little_endian") isBinary = true;
-    else if (s == "binary_big_endian") isBinary = isBigEndian = true;
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t used = 0;
+    for (auto & block : blocks) used += block.used;
+    return used;
 }
 
-void PlyFile::PlyFileImpl::read_header_element(std::istream & is)
+size_t PlyArena::bytes_reserved() const
 {
-    elements.emplace_back(is);
+    std::lock_guard<std::mutex> lock(mutex);
+    return reserved_unlocked();
 }
 
-void PlyFile::PlyFileImpl::read_header_property(std::istream & is)
+size_t PlyArena::reserved_unlocked() const
 {
-    if (!elements.size()) throw std::runtime_error("no elements defined; file is malformed");
-    elements.back().properties.emplace_back(is);
+    size_t reserved = 0;
+    for (auto & block : blocks) reserved += block.memory.size_bytes();
+    return reserved;
 }
 
-size_t PlyFile::PlyFileImpl::read_property_binary(const size_t & stride, void * dest, size_t & destOffset, size_t destSize, std::istream & is)
+PlyProperty::PlyProperty(std::istream & is) : isList(false)
 {
-    if (destOffset + stride > destSize)
+    std::string type;
+    is >> type;
+    if (type == "list")
     {
-        throw std::runtime_error("unexpected EOF. malformed file?");
+        std::string countType;
+        is >> countType >> type;
+        listType = property_type_from_string(countType);
+        isList = true;
     }
+    propertyType = property_type_from_string(type);
+    is >> name;
+}
 
-    destOffset += stride;
-    is.read((char*)dest, stride);
-    return stride;
+PlyElement::PlyElement(std::istream & is)
+{
+    is >> name >> size;
 }
 
-size_t PlyFile::PlyFileImpl::read_property_ascii(const Type & t, const size_t & stride, void * dest, size_t & destOffset, size_t destSize, std::istream & is)
+// Ascii numbers are parsed from the raw token without going through an istream: integers and
+// the common short decimal floats are handled here, anything else falls back to a classic-locale
+// stream so behavior never depends on the global locale. As elsewhere, the host is little-endian.
+
+inline bool is_eight_digits(const uint64_t v)
 {
-    if (destOffset + stride > destSize)
-    {
-        throw std::runtime_error("unexpected EOF. malformed file?");
-    }
+    return !(((v & 0xF0F0F0F0F0F0F0F0ull) | (((v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) ^ 0x3333333333333333ull);
+}
 
-    destOffset += stride;
-    switch (t)
-    {
-    case Type::INT8:       *((int8_t *)dest)  = static_cast<int8_t>(ply_read_ascii<int32_t>(is));   break;
-    case Type::UINT8:      *((uint8_t *)dest) = static_cast<uint8_t>(ply_read_ascii<uint32_t>(is)); break;
-    case Type::INT16:      ply_cast_ascii<int16_t>(dest, is);                 break;
-    case Type::UINT16:     ply_cast_ascii<uint16_t>(dest, is);                break;
-    case Type::INT32:      ply_cast_ascii<int32_t>(dest, is);                 break;
-    case Type::UINT32:     ply_cast_ascii<uint32_t>(dest, is);                break;
-    case Type::FLOAT32:    ply_cast_ascii<float>(dest, is);                   break;
-    case Type::FLOAT64:    ply_cast_ascii<double>(dest, is);                  break;
-    case Type::INVALID:    throw std::invalid_argument("invalid ply property");
-    }
-    return stride;
+inline uint32_t parse_eight_digits(uint64_t v)
+{
+    v -= 0x3030303030303030ull;
+    v = (v * 10) + (v >> 8);
+    v = (((v & 0x000000FF000000FFull) * 0x000F424000000064ull) + (((v >> 16) & 0x000000FF000000FFull) * 0x0000271000000001ull)) >> 32;
+    return static_cast<uint32_t>(v);
 }
 
-void PlyFile::PlyFileImpl::write_property_ascii(Type t, std::ostream & os, const uint8_t * src, size_t & srcOffset)
+// Accumulates a run of decimal digits into `value`, eight at a time where possible, and returns
+// how many there were. `value` is only meaningful for runs of up to 19 digits.
+inline size_t parse_digits(const char *& p, const char * last, uint64_t & value)
 {
-    switch (t)
+    const char * const first = p;
+    uint64_t word;
+    while (last - p >= 8)
     {
-    case Type::INT8:       os << static_cast<int32_t>(*reinterpret_cast<const int8_t*>(src));   break;
-    case Type::UINT8:      os << static_cast<uint32_t>(*reinterpret_cast<const uint8_t*>(src)); break;
-    case Type::INT16:      os << *reinterpret_cast<const int16_t*>(src);  break;
-    case Type::UINT16:     os << *reinterpret_cast<const uint16_t*>(src); break;
-    case Type::INT32:      os << *reinterpret_cast<const int32_t*>(src);  break;
-    case Type::UINT32:     os << *reinterpret_cast<const uint32_t*>(src); break;
-    case Type::FLOAT32:    os << *reinterpret_cast<const float*>(src);    break;
-    case Type::FLOAT64:    os << *reinterpret_cast<const double*>(src);   break;
-    case Type::INVALID:    throw std::invalid_argument("invalid ply property");
+        std::memcpy(&word, p, 8);
+        if (!is_eight_digits(word)) break;
+        value = value * 100000000 + parse_eight_digits(word);
+        p += 8;
     }
-    os << " ";
-    srcOffset += PropertyTable[t].stride;
+    while (p < last && static_cast<unsigned>(*p - '0') < 10) value = value * 10 + static_cast<uint64_t>(*p++ - '0');
+    return static_cast<size_t>(p - first);
 }
 
-void PlyFile::PlyFileImpl::write_property_binary(std::ostream & os, const uint8_t * src, size_t & srcOffset, const size_t & stride) noexcept
+inline bool token_equals(const char * first, const char * last, const char * lower)
 {
-    os.write((char *)src, stride);
-    srcOffset += stride;
+    for (; first < last && *lower; ++first, ++lower) if (std::tolower(static_cast<unsigned char>(*first)) != *lower) return false;
+    return first == last && !*lower;
 }
 
-void PlyFile::PlyFileImpl::read(std::istream & is)
+template<typename T> bool parse_ascii_float_slow(const char * first, const char * last, T & out)
+{
+    std::istringstream ss(std::string(first, last));
+    ss.imbue(std::locale::classic());
+    ss >> out;
+    return !ss.fail() && ss.peek() == std::char_traits<char>::eof();
+}
+
+template<typename T> bool parse_ascii_float(const char * first, const char * last, T & out)
 {
-    std::vector<std::shared_ptr<PlyData>> buffers;
-    for (auto & entry : userData) buffers.push_back(entry.second.data);
+    static const double exact_powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
 
-    // Discover if we can allocate up front without parsing the file twice
-    uint32_t list_hints = 0;
-    for (auto & b : buffers) for (auto & entry : userData) {list_hints += entry.second.list_size_hint;(void)b;}
+    const char * p = first;
+    const bool negative = (p < last && *p == '-');
+    if (p < last && (*p == '-' || *p == '+')) ++p;
 
-    // No list hints? Then we need to calculate how much memory to allocate
-    if (list_hints == 0)
+    if (token_equals(p, last, "nan")) { out = std::numeric_limits<T>::quiet_NaN(); return true; }
+    if (token_equals(p, last, "inf") || token_equals(p, last, "infinity"))
     {
-        parse_data(is, true);
+        out = negative ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity();
+        return true;
     }
 
-    // Count the number of properties (required for allocation)
-    // e.g. if we have properties x y and z requested, we ensure
-    // that their buffer points to the same PlyData
-    std::unordered_map<PlyData*, int32_t> unique_data_count;
-    for (auto & ptr : buffers) unique_data_count[ptr.get()] += 1;
-
-    // Since group-requested properties share the same cursor,
-    // we need to find unique cursors so we only allocate once
-    std::sort(buffers.begin(), buffers.end());
-    buffers.erase(std::unique(buffers.begin(), buffers.end()), buffers.end());
-
-    // We sorted by ptrs on PlyData, need to remap back onto its cursor in the userData table
-    for (auto & b : buffers)
+    uint64_t mantissa = 0;
+    size_t digits = parse_digits(p, last, mantissa);
+    size_t fraction_digits = 0;
+    if (p < last && *p == '.')
     {
-        for (auto & entry : userData)
-        {
-            if (entry.second.data == b && b->buffer.get() == nullptr)
-            {
-                // If we didn't receive any list hints, it means we did two passes over the
-                // file to compute the total length of all (potentially) variable-length lists
-                if (list_hints == 0)
-                {
-                    b->buffer = Buffer(entry.second.cursor->totalSizeBytes);
-                }
-                else
-                {
-                    // otherwise, we can allocate up front, skipping the first pass.
-                    const size_t list_size_multiplier = (entry.second.data->isList ? entry.second.list_size_hint : 1);
-                    auto bytes_per_property = entry.second.data->count * PropertyTable[entry.second.data->t].stride * list_size_multiplier;
-                    bytes_per_property *= unique_data_count[b.get()];
-                    b->buffer = Buffer(bytes_per_property);
-                }
+        ++p;
+        fraction_digits = parse_digits(p, last, mantissa);
+        digits += fraction_digits;
+    }
+    if (digits == 0) return false;
 
-            }
-        }
+    int64_t exponent = 0;
+    if (p < last && (*p == 'e' || *p == 'E'))
+    {
+        ++p;
+        const bool negative_exponent = (p < last && *p == '-');
+        if (p < last && (*p == '-' || *p == '+')) ++p;
+        uint64_t e = 0;
+        const size_t exponent_digits = parse_digits(p, last, e);
+        if (exponent_digits == 0) return false;
+        if (exponent_digits > 4) return parse_ascii_float_slow(first, last, out);
+        exponent = negative_exponent ? -static_cast<int64_t>(e) : static_cast<int64_t>(e);
     }
+    if (p != last) return false;
+    exponent -= static_cast<int64_t>(fraction_digits);
 
-    // Populate the data
-    parse_data(is, false);
+    // Clinger's fast path: both the mantissa and the power of ten are exact doubles, so a single
+    // correctly-rounded operation yields the correctly-rounded result
+    if (digits > 19 || mantissa > (uint64_t(1) << 53) || exponent < -22 || exponent > 22) return parse_ascii_float_slow(first, last, out);
+    double value = static_cast<double>(mantissa);
+    value = exponent < 0 ? value / exact_powers[-exponent] : value * exact_powers[exponent];
+    if (negative) value = -value;
 
-    // In-place big-endian to little-endian swapping if required
-    if (isBigEndian)
+    if (sizeof(T) == sizeof(float))
     {
-        for (auto & b : buffers)
+        // Rounding twice is only wrong if the double landed exactly between two floats
+        const float f = static_cast<float>(value);
+        if (static_cast<double>(f) != value)
         {
-            uint8_t * data_ptr = b->buffer.get();
-            const size_t stride = PropertyTable[b->t].stride;
-            const size_t buffer_size_bytes = b->buffer.size_bytes();
-
-            switch (b->t)
-            {
-            case Type::INT16:   endian_swap_buffer<int16_t, int16_t>(data_ptr, buffer_size_bytes, stride);   break;
-            case Type::UINT16:  endian_swap_buffer<uint16_t, uint16_t>(data_ptr, buffer_size_bytes, stride); break;
-            case Type::INT32:   endian_swap_buffer<int32_t, int32_t>(data_ptr, buffer_size_bytes, stride);   break;
-            case Type::UINT32:  endian_swap_buffer<uint32_t, uint32_t>(data_ptr, buffer_size_bytes, stride); break;
-            case Type::FLOAT32: endian_swap_buffer<uint32_t, float>(data_ptr, buffer_size_bytes, stride);    break;
-            case Type::FLOAT64: endian_swap_buffer<uint64_t, double>(data_ptr, buffer_size_bytes, stride);   break;
-            default: break;
-            }
+            const float g = std::nextafter(f, static_cast<float>(value > f ? std::numeric_limits<float>::infinity() : -std::numeric_limits<float>::infinity()));
+            if ((static_cast<double>(f) + static_cast<double>(g)) * 0.5 == value) return parse_ascii_float_slow(first, last, out);
         }
     }
+    out = static_cast<T>(value);
+    return true;
 }
 
-void PlyFile::PlyFileImpl::write(std::ostream & os, bool _isBinary)
+// Integers wrap to the width of `T`, as the casts from wider reads used to. Values written
+// with a fraction or exponent are truncated toward zero.
+template<typename T> bool parse_ascii_integer(const char * first, const char * last, T & out)
 {
-    for (auto & d : userData) { d.second.cursor->byteOffset = 0; }
-    if (_isBinary)
+    const char * p = first;
+    const bool negative = (p < last && *p == '-');
+    if (p < last && (*p == '-' || *p == '+')) ++p;
+
+    uint64_t magnitude = 0;
+    const size_t digits = parse_digits(p, last, magnitude);
+    if (p != last || digits == 0 || digits > 19)
     {
-        isBinary = true;
-        isBigEndian = false;
-        write_binary_internal(os);
+        double value;
+        if (!parse_ascii_float(first, last, value) || !(std::fabs(value) < 9.2e18)) return false;
+        out = static_cast<T>(static_cast<int64_t>(value));
+        return true;
     }
-    else
+    out = static_cast<T>(negative ? 0 - magnitude : magnitude);
+    return true;
+}
+
+inline bool parse_ascii_value(const Type t, const char * first, const char * last, void * dest)
+{
+    switch (t)
     {
-        isBinary = false;
-        isBigEndian = false;
-        write_ascii_internal(os);
+    case Type::INT8:       return parse_ascii_integer(first, last, *static_cast<int8_t *>(dest));
+    case Type::UINT8:      return parse_ascii_integer(first, last, *static_cast<uint8_t *>(dest));
+    case Type::INT16:      return parse_ascii_integer(first, last, *static_cast<int16_t *>(dest));
+    case Type::UINT16:     return parse_ascii_integer(first, last, *static_cast<uint16_t *>(dest));
+    case Type::INT32:      return parse_ascii_integer(first, last, *static_cast<int32_t *>(dest));
+    case Type::UINT32:     return parse_ascii_integer(first, last, *static_cast<uint32_t *>(dest));
+    case Type::FLOAT32:    return parse_ascii_float(first, last, *static_cast<float *>(dest));
+    case Type::FLOAT64:    return parse_ascii_float(first, last, *static_cast<double *>(dest));
+    case Type::INVALID:    throw std::invalid_argument("invalid ply property");
     }
+    return false;
 }
 
-void PlyFile::PlyFileImpl::write_binary_internal(std::ostream & os) noexcept
-{
-    isBinary = true;
+// Byte-order reversal of whole buffers for big-endian files. Values never straddle a 16-byte
+// lane, so a single byte shuffle per vector does it: pshufb (SSSE3, or AVX2 when the CPU has
+// it, picked at runtime) on x86 and vrev on NEON. Tails fall back to the scalar swap.
 
-    write_header(os);
+template<typename T> inline void swap_bytes_scalar(uint8_t * data, const size_t count) noexcept
+{
+    for (size_t i = 0; i < count; ++i, data += sizeof(T))
+    {
+        T v;
+        std::memcpy(&v, data, sizeof(T));
+        v = endian_swap<T, T>(v);
+        std::memcpy(data, &v, sizeof(T));
+    }
+}
 
-    uint8_t listSize[4] = { 0, 0, 0, 0 };
-    size_t dummyCount = 0;
+inline void swap_bytes_scalar(uint8_t * data, const size_t count, const size_t width) noexcept
+{
+    switch (width)
+    {
+    case 2: swap_bytes_scalar<uint16_t>(data, count); break;
+    case 4: swap_bytes_scalar<uint32_t>(data, count); break;
+    case 8: swap_bytes_scalar<uint64_t>(data, count); break;
+    default: break;
+    }
+}
 
-    auto element_property_lookup = make_property_lookup_table();
+#if defined(TINYPLY_SWAP_X86)
 
-    size_t element_idx = 0;
-    for (auto & e : elements)
+// Shuffle control that reverses each `width`-byte value of a 16-byte lane
+inline const uint8_t * swap_shuffle_mask(const size_t width) noexcept
+{
+    static const uint8_t masks[3][16] =
     {
-        for (size_t i = 0; i < e.size; ++i)
-        {
-            size_t property_index = 0;
-            for (auto & p : e.properties)
-            {
-                auto & f = element_property_lookup[element_idx][property_index];
-                auto * helper = f.helper;
-                if (f.skip || helper == nullptr) continue;
+        { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 },
+        { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 },
+        { 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 },
+    };
+    return masks[width == 2 ? 0 : width == 4 ? 1 : 2];
+}
 
-                if (p.isList)
-                {
-                    std::memcpy(listSize, &p.listCount, sizeof(uint32_t));
-                    write_property_binary(os, listSize, dummyCount, f.list_stride);
-                    write_property_binary(os, (helper->data->buffer.get_const() + helper->cursor->byteOffset), helper->cursor->byteOffset, f.prop_stride * p.listCount);
-                }
-                else
-                {
-                    write_property_binary(os, (helper->data->buffer.get_const() + helper->cursor->byteOffset), helper->cursor->byteOffset, f.prop_stride);
-                }
-                property_index++;
-            }
-        }
-        element_idx++;
+TINYPLY_TARGET("ssse3") inline size_t swap_bytes_ssse3(uint8_t * data, const size_t bytes, const size_t width) noexcept
+{
+    const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i *>(swap_shuffle_mask(width)));
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16)
+    {
+        __m128i * p = reinterpret_cast<__m128i *>(data + i);
+        _mm_storeu_si128(p, _mm_shuffle_epi8(_mm_loadu_si128(p), mask));
     }
+    return i;
 }
 
-void PlyFile::PlyFileImpl::write_ascii_internal(std::ostream & os) noexcept
+TINYPLY_TARGET("avx2") inline size_t swap_bytes_avx2(uint8_t * data, const size_t bytes, const size_t width) noexcept
 {
-    write_header(os);
-
-    auto element_property_lookup = make_property_lookup_table();
-
-    size_t element_idx = 0;
-    for (auto & e : elements)
+    const __m128i lane = _mm_loadu_si128(reinterpret_cast<const __m128i *>(swap_shuffle_mask(width)));
+    const __m256i mask = _mm256_broadcastsi128_si256(lane);
+    size_t i = 0;
+    for (; i + 32 <= bytes; i += 32)
     {
-        for (size_t i = 0; i < e.size; ++i)
-        {
-            size_t property_index = 0;
-            for (auto & p : e.properties)
-            {
-                auto & f = element_property_lookup[element_idx][property_index];
-                auto * helper = f.helper;
-                if (f.skip || helper == nullptr) continue;
+        __m256i * p = reinterpret_cast<__m256i *>(data + i);
+        _mm256_storeu_si256(p, _mm256_shuffle_epi8(_mm256_loadu_si256(p), mask));
+    }
+    return i;
+}
 
-                if (p.isList)
-                {
-                    os << p.listCount << " ";
-                    for (size_t j = 0; j < p.listCount; ++j)
-                    {
-                        write_property_ascii(p.propertyType, os, (helper->data->buffer.get() + helper->cursor->byteOffset), helper->cursor->byteOffset);
-                    }
-                }
-                else
-                {
-                    write_property_ascii(p.propertyType, os, (helper->data->buffer.get() + helper->cursor->byteOffset), helper->cursor->byteOffset);
-                }
-                property_index++;
-            }
-            os << "\n";
-        }
-        element_idx++;
+// 2 for AVX2, 1 for SSSE3, 0 for neither
+inline int detect_swap_level() noexcept
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int max_leaf = info[0];
+    __cpuid(info, 1);
+    const bool ssse3 = (info[2] & (1 << 9)) != 0;
+    const bool os_ymm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+    bool avx2 = false;
+    if (max_leaf >= 7 && os_ymm)
+    {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
     }
+    return avx2 ? 2 : ssse3 ? 1 : 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? 2 : __builtin_cpu_supports("ssse3") ? 1 : 0;
+#endif
 }
 
-void PlyFile::PlyFileImpl::write_header(std::ostream & os) noexcept
+#endif // end TINYPLY_SWAP_X86
+
+// Reverses the byte order of `count` consecutive values of `width` bytes (2, 4 or 8) in place
+inline void swap_bytes(uint8_t * data, const size_t count, const size_t width) noexcept
+{
+    if (width != 2 && width != 4 && width != 8) return;
+    const size_t bytes = count * width;
+    size_t done = 0;
+
+#if defined(TINYPLY_SWAP_X86)
+    static const int level = detect_swap_level();
+    if (level == 2) done = swap_bytes_avx2(data, bytes, width);
+    else if (level == 1) done = swap_bytes_ssse3(data, bytes, width);
+#elif defined(TINYPLY_SWAP_NEON)
+    for (; done + 16 <= bytes; done += 16)
+    {
+        const uint8x16_t v = vld1q_u8(data + done);
+        const uint8x16_t r = (width == 2) ? vrev16q_u8(v) : (width == 4) ? vrev32q_u8(v) : vrev64q_u8(v);
+        vst1q_u8(data + done, r);
+    }
+#endif
+
+    swap_bytes_scalar(data + done, (bytes - done) / width, width);
+}
+
+// Swaps `rows` runs of `row_bytes`, `stride` bytes apart
+inline void swap_rows(uint8_t * data, const size_t rows, const size_t row_bytes, const size_t stride, const size_t width) noexcept
+{
+    if (stride == row_bytes) swap_bytes(data, rows * row_bytes / width, width);
+    else for (size_t r = 0; r < rows; ++r) swap_bytes(data + r * stride, row_bytes / width, width);
+}
+
+// Conversion of values to a requested type while they are read. Values convert as by
+// static_cast, except where that would be undefined: floating-point values bound for an integer
+// type are clamped to its range (NaN becomes 0), and doubles beyond the range of float round to
+// +-max or +-infinity, as IEEE-754 rounding (and the SSE2 kernel) does. Contiguous runs of the
+// common pairs are widened or narrowed with SSE2; the remaining pairs are plain loops the compiler
+// may vectorize.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define TINYPLY_CONVERT_SSE2 1
+#endif
+
+template<typename To, typename From> inline To convert_value(const From v, std::true_type /* floating-point to integer */) noexcept
+{
+    if (!(v == v)) return 0;
+    if (v <= static_cast<From>(std::numeric_limits<To>::lowest())) return std::numeric_limits<To>::lowest();
+    if (v >= static_cast<From>(std::numeric_limits<To>::max())) return std::numeric_limits<To>::max();
+    return static_cast<To>(v);
+}
+
+template<typename To, typename From> inline To convert_value(const From v, std::false_type) noexcept { return static_cast<To>(v); }
+
+template<typename To, typename From> inline To convert_value(const From v) noexcept
+{
+    return convert_value<To>(v, std::integral_constant<bool, std::is_floating_point<From>::value && std::is_integral<To>::value>());
+}
+
+// Up to half an ulp past the largest float, a double still rounds down to it; from there on, to infinity
+template<> inline float convert_value<float, double>(const double v) noexcept
+{
+    const double max = std::numeric_limits<float>::max();
+    const double overflow = max + std::ldexp(1.0, 103);
+    if (v >= overflow) return std::numeric_limits<float>::infinity();
+    if (v <= -overflow) return -std::numeric_limits<float>::infinity();
+    if (v > max) return std::numeric_limits<float>::max();
+    if (v < -max) return std::numeric_limits<float>::lowest();
+    return static_cast<float>(v);
+}
+
+// Loads a value stored in the opposite byte order
+template<typename T> inline T load_swapped(const uint8_t * src) noexcept
+{
+    typedef typename std::conditional<sizeof(T) == 1, uint8_t,
+        typename std::conditional<sizeof(T) == 2, uint16_t,
+        typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type>::type>::type Bits;
+    Bits bits;
+    std::memcpy(&bits, src, sizeof(T));
+    bits = endian_swap<Bits, Bits>(bits);
+    T v;
+    std::memcpy(&v, &bits, sizeof(T));
+    return v;
+}
+
+template<typename From, typename To> inline void convert_values(uint8_t * dst, const uint8_t * src, const size_t count) noexcept
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        From v;
+        std::memcpy(&v, src + i * sizeof(From), sizeof(From));
+        const To t = convert_value<To>(v);
+        std::memcpy(dst + i * sizeof(To), &t, sizeof(To));
+    }
+}
+
+#if defined(TINYPLY_CONVERT_SSE2)
+
+template<> inline void convert_values<double, float>(uint8_t * dst, const uint8_t * src, const size_t count) noexcept
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(reinterpret_cast<const double *>(src) + i));
+        const __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(reinterpret_cast<const double *>(src) + i + 2));
+        _mm_storeu_ps(reinterpret_cast<float *>(dst) + i, _mm_movelh_ps(lo, hi));
+    }
+    for (; i < count; ++i) { double v; std::memcpy(&v, src + i * 8, 8); const float t = convert_value<float>(v); std::memcpy(dst + i * 4, &t, 4); }
+}
+
+template<> inline void convert_values<float, double>(uint8_t * dst, const uint8_t * src, const size_t count) noexcept
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 v = _mm_loadu_ps(reinterpret_cast<const float *>(src) + i);
+        _mm_storeu_pd(reinterpret_cast<double *>(dst) + i, _mm_cvtps_pd(v));
+        _mm_storeu_pd(reinterpret_cast<double *>(dst) + i + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+    }
+    for (; i < count; ++i) { float v; std::memcpy(&v, src + i * 4, 4); const double t = v; std::memcpy(dst + i * 8, &t, 8); }
+}
+
+template<> inline void convert_values<int32_t, float>(uint8_t * dst, const uint8_t * src, const size_t count) noexcept
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+        _mm_storeu_ps(reinterpret_cast<float *>(dst) + i, _mm_cvtepi32_ps(v));
+    }
+    for (; i < count; ++i) { int32_t v; std::memcpy(&v, src + i * 4, 4); const float t = static_cast<float>(v); std::memcpy(dst + i * 4, &t, 4); }
+}
+
+template<> inline void convert_values<uint8_t, float>(uint8_t * dst, const uint8_t * src, const size_t count) noexcept
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        const __m128i lo = _mm_unpacklo_epi8(v, zero);
+        const __m128i hi = _mm_unpackhi_epi8(v, zero);
+        float * out = reinterpret_cast<float *>(dst) + i;
+        _mm_storeu_ps(out + 0,  _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+        _mm_storeu_ps(out + 4,  _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+        _mm_storeu_ps(out + 8,  _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+        _mm_storeu_ps(out + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+    }
+    for (; i < count; ++i) { const float t = static_cast<float>(src[i]); std::memcpy(dst + i * 4, &t, 4); }
+}
+
+#endif // end TINYPLY_CONVERT_SSE2
+
+// Converts `per_row` consecutive values from each of `rows` runs `src_stride` bytes apart into runs
+// `dst_stride` bytes apart. With `swap`, the source values are byte-swapped before conversion.
+template<typename From, typename To>
+inline void convert_strided(uint8_t * dst, const size_t dst_stride, const uint8_t * src, const size_t src_stride,
+    const size_t rows, const size_t per_row, const bool swap) noexcept
+{
+    if (!swap && src_stride == per_row * sizeof(From) && dst_stride == per_row * sizeof(To))
+    {
+        convert_values<From, To>(dst, src, rows * per_row);
+        return;
+    }
+    for (size_t r = 0; r < rows; ++r, src += src_stride, dst += dst_stride)
+    {
+        if (!swap) convert_values<From, To>(dst, src, per_row);
+        else for (size_t j = 0; j < per_row; ++j)
+        {
+            const To t = convert_value<To>(load_swapped<From>(src + j * sizeof(From)));
+            std::memcpy(dst + j * sizeof(To), &t, sizeof(To));
+        }
+    }
+}
+
+template<typename From>
+inline void convert_strided(const Type to, uint8_t * dst, const size_t dst_stride, const uint8_t * src, const size_t src_stride,
+    const size_t rows, const size_t per_row, const bool swap) noexcept
+{
+    switch (to)
+    {
+    case Type::INT8:    convert_strided<From, int8_t>(dst, dst_stride, src, src_stride, rows, per_row, swap);   break;
+    case Type::UINT8:   convert_strided<From, uint8_t>(dst, dst_stride, src, src_stride, rows, per_row, swap);  break;
+    case Type::INT16:   convert_strided<From, int16_t>(dst, dst_stride, src, src_stride, rows, per_row, swap);  break;
+    case Type::UINT16:  convert_strided<From, uint16_t>(dst, dst_stride, src, src_stride, rows, per_row, swap); break;
+    case Type::INT32:   convert_strided<From, int32_t>(dst, dst_stride, src, src_stride, rows, per_row, swap);  break;
+    case Type::UINT32:  convert_strided<From, uint32_t>(dst, dst_stride, src, src_stride, rows, per_row, swap); break;
+    case Type::FLOAT32: convert_strided<From, float>(dst, dst_stride, src, src_stride, rows, per_row, swap);    break;
+    case Type::FLOAT64: convert_strided<From, double>(dst, dst_stride, src, src_stride, rows, per_row, swap);   break;
+    case Type::INVALID: break;
+    }
+}
+
+inline void convert_strided(const Type from, const Type to, uint8_t * dst, const size_t dst_stride, const uint8_t * src, const size_t src_stride,
+    const size_t rows, const size_t per_row, const bool swap) noexcept
+{
+    switch (from)
+    {
+    case Type::INT8:    convert_strided<int8_t>(to, dst, dst_stride, src, src_stride, rows, per_row, swap);   break;
+    case Type::UINT8:   convert_strided<uint8_t>(to, dst, dst_stride, src, src_stride, rows, per_row, swap);  break;
+    case Type::INT16:   convert_strided<int16_t>(to, dst, dst_stride, src, src_stride, rows, per_row, swap);  break;
+    case Type::UINT16:  convert_strided<uint16_t>(to, dst, dst_stride, src, src_stride, rows, per_row, swap); break;
+    case Type::INT32:   convert_strided<int32_t>(to, dst, dst_stride, src, src_stride, rows, per_row, swap);  break;
+    case Type::UINT32:  convert_strided<uint32_t>(to, dst, dst_stride, src, src_stride, rows, per_row, swap); break;
+    case Type::FLOAT32: convert_strided<float>(to, dst, dst_stride, src, src_stride, rows, per_row, swap);    break;
+    case Type::FLOAT64: convert_strided<double>(to, dst, dst_stride, src, src_stride, rows, per_row, swap);   break;
+    case Type::INVALID: break;
+    }
+}
+
+// Ascii output is formatted straight into a character buffer. Integers are written two digits at a
+// time; floats get the shortest digit string that reads back to the identical value, via Grisu2
+// (Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers", 2010).
+
+static const size_t max_ascii_value_bytes = 48; // longest formatted value, sign and separator included
+
+inline char * format_uint(uint64_t v, char * out)
+{
+    static const char two_digits[] =
+        "0001020304050607080910111213141516171819"
+        "2021222324252627282930313233343536373839"
+        "4041424344454647484950515253545556575859"
+        "6061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+
+    char digits[20];
+    char * p = digits + sizeof(digits);
+    while (v >= 100)
+    {
+        p -= 2;
+        std::memcpy(p, two_digits + (v % 100) * 2, 2);
+        v /= 100;
+    }
+    if (v >= 10)
+    {
+        p -= 2;
+        std::memcpy(p, two_digits + v * 2, 2);
+    }
+    else *--p = static_cast<char>('0' + v);
+
+    const size_t n = static_cast<size_t>(digits + sizeof(digits) - p);
+    std::memcpy(out, p, n);
+    return out + n;
+}
+
+inline char * format_int(const int64_t v, char * out)
+{
+    if (v >= 0) return format_uint(static_cast<uint64_t>(v), out);
+    *out++ = '-';
+    return format_uint(0 - static_cast<uint64_t>(v), out);
+}
+
+struct DiyFp
+{
+    uint64_t f;
+    int e;
+    DiyFp(const uint64_t _f, const int _e) : f(_f), e(_e) {}
+};
+
+inline DiyFp diyfp_sub(const DiyFp & x, const DiyFp & y) { return DiyFp(x.f - y.f, x.e); }
+
+// Shifts the leading one into the top bit, found by binary search
+inline DiyFp diyfp_normalize(DiyFp x)
+{
+    for (int shift = 32; shift > 0; shift >>= 1)
+    {
+        if ((x.f >> (64 - shift)) == 0) { x.f <<= shift; x.e -= shift; }
+    }
+    return x;
+}
+
+// The upper 64 bits of the 128-bit product, rounded
+inline DiyFp diyfp_mul(const DiyFp & x, const DiyFp & y)
+{
+    const uint64_t x_lo = x.f & 0xFFFFFFFFu, x_hi = x.f >> 32;
+    const uint64_t y_lo = y.f & 0xFFFFFFFFu, y_hi = y.f >> 32;
+    const uint64_t p0 = x_lo * y_lo, p1 = x_lo * y_hi, p2 = x_hi * y_lo, p3 = x_hi * y_hi;
+    uint64_t q = (p0 >> 32) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu);
+    q += uint64_t(1) << 31;
+    return DiyFp(p3 + (p1 >> 32) + (p2 >> 32) + (q >> 32), x.e + y.e + 64);
+}
+
+// Normalized approximations of 10^k for k = -300, -292, ..., 324
+struct CachedPower { uint64_t f; int e; int k; };
+
+inline CachedPower cached_power_for_binary_exponent(const int e)
+{
+    static const CachedPower powers[] =
+    {
+        { 0xAB70FE17C79AC6CA, -1060, -300 }, { 0xFF77B1FCBEBCDC4F, -1034, -292 }, { 0xBE5691EF416BD60C, -1007, -284 },
+        { 0x8DD01FAD907FFC3C,  -980, -276 }, { 0xD3515C2831559A83,  -954, -268 }, { 0x9D71AC8FADA6C9B5,  -927, -260 },
+        { 0xEA9C227723EE8BCB,  -901, -252 }, { 0xAECC49914078536D,  -874, -244 }, { 0x823C12795DB6CE57,  -847, -236 },
+        { 0xC21094364DFB5637,  -821, -228 }, { 0x9096EA6F3848984F,  -794, -220 }, { 0xD77485CB25823AC7,  -768, -212 },
+        { 0xA086CFCD97BF97F4,  -741, -204 }, { 0xEF340A98172AACE5,  -715, -196 }, { 0xB23867FB2A35B28E,  -688, -188 },
+        { 0x84C8D4DFD2C63F3B,  -661, -180 }, { 0xC5DD44271AD3CDBA,  -635, -172 }, { 0x936B9FCEBB25C996,  -608, -164 },
+        { 0xDBAC6C247D62A584,  -582, -156 }, { 0xA3AB66580D5FDAF6,  -555, -148 }, { 0xF3E2F893DEC3F126,  -529, -140 },
+        { 0xB5B5ADA8AAFF80B8,  -502, -132 }, { 0x87625F056C7C4A8B,  -475, -124 }, { 0xC9BCFF6034C13053,  -449, -116 },
+        { 0x964E858C91BA2655,  -422, -108 }, { 0xDFF9772470297EBD,  -396, -100 }, { 0xA6DFBD9FB8E5B88F,  -369,  -92 },
+        { 0xF8A95FCF88747D94,  -343,  -84 }, { 0xB94470938FA89BCF,  -316,  -76 }, { 0x8A08F0F8BF0F156B,  -289,  -68 },
+        { 0xCDB02555653131B6,  -263,  -60 }, { 0x993FE2C6D07B7FAC,  -236,  -52 }, { 0xE45C10C42A2B3B06,  -210,  -44 },
+        { 0xAA242499697392D3,  -183,  -36 }, { 0xFD87B5F28300CA0E,  -157,  -28 }, { 0xBCE5086492111AEB,  -130,  -20 },
+        { 0x8CBCCC096F5088CC,  -103,  -12 }, { 0xD1B71758E219652C,   -77,   -4 }, { 0x9C40000000000000,   -50,    4 },
+        { 0xE8D4A51000000000,   -24,   12 }, { 0xAD78EBC5AC620000,     3,   20 }, { 0x813F3978F8940984,    30,   28 },
+        { 0xC097CE7BC90715B3,    56,   36 }, { 0x8F7E32CE7BEA5C70,    83,   44 }, { 0xD5D238A4ABE98068,   109,   52 },
+        { 0x9F4F2726179A2245,   136,   60 }, { 0xED63A231D4C4FB27,   162,   68 }, { 0xB0DE65388CC8ADA8,   189,   76 },
+        { 0x83C7088E1AAB65DB,   216,   84 }, { 0xC45D1DF942711D9A,   242,   92 }, { 0x924D692CA61BE758,   269,  100 },
+        { 0xDA01EE641A708DEA,   295,  108 }, { 0xA26DA3999AEF774A,   322,  116 }, { 0xF209787BB47D6B85,   348,  124 },
+        { 0xB454E4A179DD1877,   375,  132 }, { 0x865B86925B9BC5C2,   402,  140 }, { 0xC83553C5C8965D3D,   428,  148 },
+        { 0x952AB45CFA97A0B3,   455,  156 }, { 0xDE469FBD99A05FE3,   481,  164 }, { 0xA59BC234DB398C25,   508,  172 },
+        { 0xF6C69A72A3989F5C,   534,  180 }, { 0xB7DCBF5354E9BECE,   561,  188 }, { 0x88FCF317F22241E2,   588,  196 },
+        { 0xCC20CE9BD35C78A5,   614,  204 }, { 0x98165AF37B2153DF,   641,  212 }, { 0xE2A0B5DC971F303A,   667,  220 },
+        { 0xA8D9D1535CE3B396,   694,  228 }, { 0xFB9B7CD9A4A7443C,   720,  236 }, { 0xBB764C4CA7A44410,   747,  244 },
+        { 0x8BAB8EEFB6409C1A,   774,  252 }, { 0xD01FEF10A657842C,   800,  260 }, { 0x9B10A4E5E9913129,   827,  268 },
+        { 0xE7109BFBA19C0C9D,   853,  276 }, { 0xAC2820D9623BF429,   880,  284 }, { 0x80444B5E7AA7CF85,   907,  292 },
+        { 0xBF21E44003ACDD2D,   933,  300 }, { 0x8E679C2F5E44FF8F,   960,  308 }, { 0xD433179D9C8CB841,   986,  316 },
+        { 0x9E19DB92B4E31BA9,  1013,  324 },
+    };
+
+    // Picks the power that scales the product's binary exponent into [-60, -32]
+    const int f = -60 - e - 1;
+    const int k = (f * 78913) / (1 << 18) + static_cast<int>(f > 0);
+    return powers[(300 + k + 7) / 8];
+}
+
+inline void grisu2_round(char * buffer, const size_t length, const uint64_t dist, const uint64_t delta, uint64_t rest, const uint64_t ten_k)
+{
+    while (rest < dist && delta - rest >= ten_k && (rest + ten_k < dist || dist - rest > rest + ten_k - dist))
+    {
+        buffer[length - 1]--;
+        rest += ten_k;
+    }
+}
+
+// Generates the shortest digits of a value within (M_minus, M_plus), closest to w
+inline void grisu2_digit_gen(char * buffer, size_t & length, int & decimal_exponent, const DiyFp & M_minus, const DiyFp & w, const DiyFp & M_plus)
+{
+    uint64_t delta = diyfp_sub(M_plus, M_minus).f;
+    uint64_t dist = diyfp_sub(M_plus, w).f;
+    const DiyFp one(uint64_t(1) << -M_plus.e, M_plus.e);
+
+    uint32_t p1 = static_cast<uint32_t>(M_plus.f >> -one.e);
+    uint64_t p2 = M_plus.f & (one.f - 1);
+
+    uint32_t pow10 = 1000000000;
+    int n = 10;
+    while (n > 1 && p1 < pow10) { pow10 /= 10; --n; }
+
+    while (n > 0)
+    {
+        buffer[length++] = static_cast<char>('0' + p1 / pow10);
+        p1 %= pow10;
+        n--;
+        const uint64_t rest = (uint64_t(p1) << -one.e) + p2;
+        if (rest <= delta)
+        {
+            decimal_exponent += n;
+            grisu2_round(buffer, length, dist, delta, rest, uint64_t(pow10) << -one.e);
+            return;
+        }
+        pow10 /= 10;
+    }
+
+    int m = 0;
+    for (;;)
+    {
+        p2 *= 10;
+        buffer[length++] = static_cast<char>('0' + (p2 >> -one.e));
+        p2 &= one.f - 1;
+        m++;
+        delta *= 10;
+        dist *= 10;
+        if (p2 <= delta) break;
+    }
+    decimal_exponent -= m;
+    grisu2_round(buffer, length, dist, delta, p2, one.f);
+}
+
+template<typename T> char * format_shortest(T value, char * out)
+{
+    typedef typename std::conditional<sizeof(T) == sizeof(uint32_t), uint32_t, uint64_t>::type Bits;
+
+    if (value != value) { std::memcpy(out, "nan", 3); return out + 3; }
+    if (std::signbit(value)) { *out++ = '-'; value = -value; }
+    if (value == std::numeric_limits<T>::infinity()) { std::memcpy(out, "inf", 3); return out + 3; }
+    if (value == 0) { *out++ = '0'; return out; }
+
+    // The value and the boundaries of the interval that rounds to it
+    const int precision = std::numeric_limits<T>::digits;
+    const int bias = std::numeric_limits<T>::max_exponent - 1 + (precision - 1);
+    const uint64_t hidden_bit = uint64_t(1) << (precision - 1);
+    Bits bits;
+    std::memcpy(&bits, &value, sizeof(T));
+    const uint64_t E = static_cast<uint64_t>(bits) >> (precision - 1);
+    const uint64_t F = static_cast<uint64_t>(bits) & (hidden_bit - 1);
+
+    const DiyFp v = (E == 0) ? DiyFp(F, 1 - bias) : DiyFp(F + hidden_bit, static_cast<int>(E) - bias);
+    const bool lower_boundary_is_closer = (F == 0 && E > 1);
+    const DiyFp m_plus(2 * v.f + 1, v.e - 1);
+    const DiyFp m_minus = lower_boundary_is_closer ? DiyFp(4 * v.f - 1, v.e - 2) : DiyFp(2 * v.f - 1, v.e - 1);
+    const DiyFp w_plus = diyfp_normalize(m_plus);
+    const DiyFp w_minus(m_minus.f << (m_minus.e - w_plus.e), w_plus.e);
+    const DiyFp w = diyfp_normalize(v);
+
+    const CachedPower cached = cached_power_for_binary_exponent(w_plus.e);
+    const DiyFp c_minus_k(cached.f, cached.e);
+    const DiyFp scaled_w = diyfp_mul(w, c_minus_k);
+    const DiyFp scaled_minus = diyfp_mul(w_minus, c_minus_k);
+    const DiyFp scaled_plus = diyfp_mul(w_plus, c_minus_k);
+
+    char digits[18];
+    size_t length = 0;
+    int decimal_exponent = -cached.k;
+    grisu2_digit_gen(digits, length, decimal_exponent, DiyFp(scaled_minus.f + 1, scaled_minus.e), scaled_w, DiyFp(scaled_plus.f - 1, scaled_plus.e));
+
+    // Plain notation for moderate magnitudes, scientific otherwise
+    const int k = static_cast<int>(length);
+    const int point = k + decimal_exponent; // digits[0, point) precede the decimal point
+    if (k <= point && point <= 21)
+    {
+        std::memcpy(out, digits, length);
+        std::memset(out + k, '0', point - k);
+        return out + point;
+    }
+    if (0 < point && point <= 21)
+    {
+        std::memcpy(out, digits, point);
+        out[point] = '.';
+        std::memcpy(out + point + 1, digits + point, k - point);
+        return out + k + 1;
+    }
+    if (-6 < point && point <= 0)
+    {
+        out[0] = '0';
+        out[1] = '.';
+        std::memset(out + 2, '0', -point);
+        std::memcpy(out + 2 - point, digits, length);
+        return out + 2 - point + k;
+    }
+
+    *out++ = digits[0];
+    if (k > 1)
+    {
+        *out++ = '.';
+        std::memcpy(out, digits + 1, k - 1);
+        out += k - 1;
+    }
+    *out++ = 'e';
+    int exponent = point - 1;
+    if (exponent < 0) { *out++ = '-'; exponent = -exponent; }
+    else *out++ = '+';
+    if (exponent < 10) *out++ = '0';
+    return format_uint(static_cast<uint64_t>(exponent), out);
+}
+
+// Exactly `decimals` digits after the point, rounded half away from zero. Magnitudes beyond what
+// the fixed-point path can represent are written in shortest form instead.
+template<typename T> char * format_fixed(const T value, const int decimals, char * out)
+{
+    static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17 };
+
+    const double scaled = std::floor(std::fabs(static_cast<double>(value)) * powers[decimals] + 0.5);
+    if (!(scaled < 1.8e19)) return format_shortest(value, out);
+
+    const uint64_t digits = static_cast<uint64_t>(scaled);
+    const uint64_t unit = static_cast<uint64_t>(powers[decimals]);
+    if (value < 0) *out++ = '-';
+    out = format_uint(digits / unit, out);
+    if (decimals == 0) return out;
+
+    *out++ = '.';
+    char fraction[20];
+    char * end = format_uint(digits % unit, fraction);
+    const size_t width = static_cast<size_t>(end - fraction);
+    std::memset(out, '0', decimals - width);
+    std::memcpy(out + decimals - width, fraction, width);
+    return out + decimals;
+}
+
+template<typename T> T load_value(const uint8_t * src)
+{
+    T v;
+    std::memcpy(&v, src, sizeof(T));
+    return v;
+}
+
+// Writes one value of type `t`; floats are formatted with `decimals` fixed digits, or in shortest
+// form if that is negative
+inline char * format_ascii_value(const Type t, const uint8_t * src, const int decimals, char * out)
+{
+    switch (t)
+    {
+    case Type::INT8:       return format_int(load_value<int8_t>(src), out);
+    case Type::UINT8:      return format_uint(load_value<uint8_t>(src), out);
+    case Type::INT16:      return format_int(load_value<int16_t>(src), out);
+    case Type::UINT16:     return format_uint(load_value<uint16_t>(src), out);
+    case Type::INT32:      return format_int(load_value<int32_t>(src), out);
+    case Type::UINT32:     return format_uint(load_value<uint32_t>(src), out);
+    case Type::FLOAT32:    return decimals < 0 ? format_shortest(load_value<float>(src), out) : format_fixed(load_value<float>(src), decimals, out);
+    case Type::FLOAT64:    return decimals < 0 ? format_shortest(load_value<double>(src), out) : format_fixed(load_value<double>(src), decimals, out);
+    case Type::INVALID:    throw std::invalid_argument("invalid ply property");
+    }
+    return out;
+}
+
+int64_t find_element(const std::string & key, const std::vector<PlyElement> & list)
+{
+    for (size_t i = 0; i < list.size(); i++) if (list[i].name == key) return i;
+    return -1;
+}
+
+int64_t find_property(const std::string & key, const std::vector<PlyProperty> & list)
+{
+    for (size_t i = 0; i < list.size(); ++i) if (list[i].name == key) return i;
+    return -1;
+}
+
+PlyFile::PlyFileImpl::ParsingHelper * PlyFile::PlyFileImpl::find_request(const size_t element_idx, const size_t property_idx) const
+{
+    if (element_idx >= requestTable.size() || property_idx >= requestTable[element_idx].size()) return nullptr;
+    return requestTable[element_idx][property_idx];
+}
+
+// Returns false if the property has already been requested
+bool PlyFile::PlyFileImpl::insert_request(const size_t element_idx, const size_t property_idx, const ParsingHelper & helper)
+{
+    if (requestTable.size() <= element_idx) requestTable.resize(element_idx + 1);
+    std::vector<ParsingHelper *> & row = requestTable[element_idx];
+    if (row.size() <= property_idx) row.resize(property_idx + 1, nullptr);
+    if (row[property_idx]) return false;
+    userData.push_back(helper);
+    row[property_idx] = &userData.back();
+    return true;
+}
+
+// The `userData` table is an easy data structure for capturing what data the
+// user would like out of the ply file, and `requestTable` addresses it by position.
+// The property lookup table flattens both down into a 2D array optimized
+// for parsing. The first index is the element, and the second index is the property.
+std::vector<std::vector<PlyFile::PlyFileImpl::PropertyLookup>> PlyFile::PlyFileImpl::make_property_lookup_table()
+{
+    std::vector<std::vector<PropertyLookup>> element_property_lookup;
+
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        std::vector<PropertyLookup> lookups;
+
+        for (size_t j = 0; j < elements[i].properties.size(); ++j)
+        {
+            const PlyProperty & property = elements[i].properties[j];
+            PropertyLookup f;
+
+            f.helper = find_request(i, j);
+            f.skip = (f.helper == nullptr);
+
+            f.prop_stride = type_stride(property.propertyType);
+            if (property.isList) f.list_stride = type_stride(property.listType);
+            f.dst_stride = f.skip ? f.prop_stride : type_stride(f.helper->data->t);
+
+            lookups.push_back(f);
+        }
+
+        element_property_lookup.push_back(lookups);
+    }
+
+    return element_property_lookup;
+}
+
+bool PlyFile::PlyFileImpl::parse_header(std::istream & is)
+{
+    // Lines are gathered up to `end_header`, so that the stream is left at the start of the payload
+    const auto t0 = std::chrono::steady_clock::now();
+    std::string header, line;
+    while (std::getline(is, line))
+    {
+        header += line;
+        if (!is.eof()) header += '\n';
+        size_t first = 0;
+        while (first < line.size() && is_ascii_space(static_cast<uint8_t>(line[first]))) ++first;
+        if (line.compare(first, 10, "end_header") == 0 && (line.size() == first + 10 || is_ascii_space(static_cast<uint8_t>(line[first + 10])))) break;
+    }
+    const bool success = parse_header_text(header.data(), header.size());
+    if (stats) stats->header_ms = elapsed_ms(t0);
+    return success;
+}
+
+inline bool token_is(const char * first, const char * last, const char * text, const size_t length)
+{
+    return static_cast<size_t>(last - first) == length && std::memcmp(first, text, length) == 0;
+}
+
+// A single pass over the header in memory, which splits each line into tokens in place.
+bool PlyFile::PlyFileImpl::parse_header_text(const char * data, const size_t size)
+{
+    const auto t0 = std::chrono::steady_clock::now();
+    bool success = true;
+    payloadOffset = 0;
+    headerLines.clear();
+    const char * p = data;
+    const char * const end = data + size;
+    while (p < end)
+    {
+        const char * eol = static_cast<const char *>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        if (!eol) eol = end;
+        const size_t length = static_cast<size_t>(eol - p);
+        const char * line = p;
+        p = (eol < end) ? eol + 1 : end;
+        payloadOffset = static_cast<size_t>(p - data);
+
+        ByteSource tokens(reinterpret_cast<const uint8_t *>(line), length);
+        const char * first = line, * last = line;
+        tokens.next_token(first, last);
+        const bool comment = token_is(first, last, "comment", 7), obj_info = token_is(first, last, "obj_info", 8);
+        if (!comment && !obj_info && first != last)
+        {
+            HeaderLine h;
+            h.text.assign(line, length);
+            h.element = token_is(first, last, "element", 7);
+            if (h.element) h.text.erase(h.text.find_last_of(" \t", h.text.find_last_not_of(" \t\r")) + 1);
+            headerLines.push_back(h);
+        }
+
+        if (first == last || token_is(first, last, "ply", 3) || token_is(first, last, "PLY", 3)) continue;
+        else if (comment)                                 read_header_text(std::string(line, length), comments, 8);
+        else if (token_is(first, last, "format", 6))      read_header_format(tokens);
+        else if (token_is(first, last, "element", 7))     read_header_element(tokens);
+        else if (token_is(first, last, "property", 8))    read_header_property(tokens);
+        else if (obj_info)                                read_header_text(std::string(line, length), objInfo, 9);
+        else if (token_is(first, last, "end_header", 10)) break;
+        else success = false; // unexpected header field
+    }
+    compute_element_offsets();
+    if (stats)
+    {
+        *stats = PlyReadStats();
+        stats->header_ms = elapsed_ms(t0);
+    }
+    return success;
+}
+
+// In binary files, the extent of every element up to (and including) the first one with
+// list properties follows from the header alone. Later offsets are filled in by `read`.
+void PlyFile::PlyFileImpl::compute_element_offsets()
+{
+    elementOffsets.assign(elements.size(), -1);
+    elementIndex.assign(elements.size(), ElementIndex());
+    int64_t offset = static_cast<int64_t>(payloadOffset);
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        if (i == 0 || isBinary) elementOffsets[i] = offset;
+        if (!isBinary) break;
+
+        size_t row_stride = 0;
+        for (auto & p : elements[i].properties)
+        {
+            if (p.isList) return;
+            row_stride += type_stride(p.propertyType);
+        }
+        offset += static_cast<int64_t>(elements[i].size * row_stride);
+    }
+}
+
+// Identifies a header for the purposes of the sidecar index
+uint64_t PlyFile::PlyFileImpl::header_hash() const
+{
+    std::stringstream ss;
+    ss << (isBinary ? (isBigEndian ? "be" : "le") : "ascii") << "\n";
+    for (auto & e : elements)
+    {
+        ss << e.name << " " << e.size << "\n";
+        for (auto & p : e.properties) ss << static_cast<int>(p.isList) << " " << static_cast<int>(p.listType) << " " << static_cast<int>(p.propertyType) << " " << p.name << "\n";
+    }
+    const std::string str = ss.str();
+    uint64_t result = 0xcbf29ce484222325ull;
+    for (auto & c : str) { result ^= static_cast<uint8_t>(c); result *= 0x100000001b3ull; }
+    return result;
+}
+
+bool PlyFile::PlyFileImpl::stat_file(const std::string & path, uint64_t & size, int64_t & mtime)
+{
+#if defined(_WIN32)
+    struct _stat64 st;
+    if (_stat64(path.c_str(), &st) != 0) return false;
+#else
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) return false;
+#endif
+    size = static_cast<uint64_t>(st.st_size);
+    mtime = static_cast<int64_t>(st.st_mtime);
+    return true;
+}
+
+// The sidecar index is a flat little-endian file:
+//   magic "TPLYIDX1", u64 file size, i64 mtime, u64 header hash, u64 checkpoint rows, u64 element count
+//   per element: i64 offset, u8 complete, u64 property count,
+//                per property: u64 total list length, u64 min length, u64 max length,
+//                u64 checkpoint count, u64 checkpoint offsets...
+bool PlyFile::PlyFileImpl::load_index()
+{
+    std::ifstream is(indexPath + ".idx", std::ios::binary);
+    if (!is) return false;
+
+    auto read_u64 = [&is]() { uint64_t v = 0; is.read(reinterpret_cast<char *>(&v), sizeof(v)); return v; };
+
+    char magic[8];
+    is.read(magic, sizeof(magic));
+    if (!is || std::memcmp(magic, "TPLYIDX1", sizeof(magic)) != 0) return false;
+
+    uint64_t file_size = 0;
+    int64_t mtime = 0;
+    if (!stat_file(indexPath, file_size, mtime)) return false;
+    if (read_u64() != file_size || static_cast<int64_t>(read_u64()) != mtime || read_u64() != header_hash()) return false;
+    if (read_u64() != index_checkpoint_rows || read_u64() != elements.size()) return false;
+
+    std::vector<int64_t> offsets(elements.size());
+    std::vector<ElementIndex> index(elements.size());
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        offsets[i] = static_cast<int64_t>(read_u64());
+        char complete = 0;
+        is.read(&complete, 1);
+        index[i].complete = complete != 0;
+        if (read_u64() != elements[i].properties.size()) return false;
+        index[i].lists.resize(elements[i].properties.size());
+        for (auto & l : index[i].lists)
+        {
+            l.total = read_u64();
+            l.min = read_u64();
+            l.max = read_u64();
+        }
+        index[i].checkpoints.resize(static_cast<size_t>(read_u64()));
+        if (index[i].checkpoints.size() > elements[i].size / index_checkpoint_rows + 1) return false;
+        for (auto & c : index[i].checkpoints) c = read_u64();
+    }
+    if (!is) return false;
+
+    for (size_t i = 0; i < elements.size(); ++i) if (elementOffsets[i] < 0) elementOffsets[i] = offsets[i];
+    elementIndex = index;
+    return true;
+}
+
+void PlyFile::PlyFileImpl::save_index()
+{
+    uint64_t file_size = 0;
+    int64_t mtime = 0;
+    if (!stat_file(indexPath, file_size, mtime)) return;
+
+    // The index is a cache; failing to write it is not an error
+    std::ofstream os(indexPath + ".idx", std::ios::binary | std::ios::trunc);
+    if (!os) return;
+
+    auto write_u64 = [&os](const uint64_t v) { os.write(reinterpret_cast<const char *>(&v), sizeof(v)); };
+
+    os.write("TPLYIDX1", 8);
+    write_u64(file_size);
+    write_u64(static_cast<uint64_t>(mtime));
+    write_u64(header_hash());
+    write_u64(index_checkpoint_rows);
+    write_u64(elements.size());
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        const ElementIndex & ei = elementIndex[i];
+        write_u64(static_cast<uint64_t>(elementOffsets[i]));
+        const char complete = ei.complete ? 1 : 0;
+        os.write(&complete, 1);
+        write_u64(elements[i].properties.size());
+        for (size_t j = 0; j < elements[i].properties.size(); ++j)
+        {
+            const ListStats l = j < ei.lists.size() ? ei.lists[j] : ListStats();
+            write_u64(l.total);
+            write_u64(l.min);
+            write_u64(l.max);
+        }
+        write_u64(ei.checkpoints.size());
+        for (auto & c : ei.checkpoints) write_u64(c);
+    }
+}
+
+bool PlyFile::PlyFileImpl::use_sidecar_index(const std::string & plyPath)
+{
+    indexPath = plyPath;
+    indexDirty = !load_index();
+    return !indexDirty;
+}
+
+// Sizes every requested group exactly when the sidecar index knows the list lengths of every
+// requested list property. Returns false (touching nothing) when it does not.
+bool PlyFile::PlyFileImpl::apply_index()
+{
+    if (indexPath.empty()) return false;
+
+    auto element_property_lookup = make_property_lookup_table();
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        for (size_t j = 0; j < elements[i].properties.size(); ++j)
+        {
+            if (!element_property_lookup[i][j].skip && elements[i].properties[j].isList && !elementIndex[i].complete) return false;
+        }
+    }
+
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        for (size_t j = 0; j < elements[i].properties.size(); ++j)
+        {
+            PropertyLookup & f = element_property_lookup[i][j];
+            PlyProperty & p = elements[i].properties[j];
+            if (f.skip) continue;
+            if (!p.isList)
+            {
+                f.helper->cursor->totalSizeBytes += elements[i].size * f.dst_stride;
+                continue;
+            }
+            const ListStats & l = elementIndex[i].lists[j];
+            f.helper->cursor->totalSizeBytes += static_cast<size_t>(l.total) * f.dst_stride;
+
+            // Mirrors what reading the lists records
+            if (elements[i].size > 0) p.listCount = (l.min == l.max) ? static_cast<size_t>(l.max) : 0;
+        }
+    }
+    return true;
+}
+
+bool PlyFile::PlyFileImpl::parse_header(const uint8_t * data, const size_t size)
+{
+    return parse_header_text(reinterpret_cast<const char *>(data), size);
+}
+
+void PlyFile::PlyFileImpl::read_header_text(std::string line, std::vector<std::string>& place, int erase)
+{
+    place.push_back((erase > 0) ? line.erase(0, erase) : line);
+}
+
+void PlyFile::PlyFileImpl::read_header_format(ByteSource & tokens)
+{
+    const char * first = nullptr, * last = nullptr;
+    tokens.next_token(first, last);
+    if (token_is(first, last, "binary_little_endian", 20)) isBinary = true;
+    else if (token_is(first, last, "binary_big_endian", 17)) isBinary = isBigEndian = true;
+}
+
+void PlyFile::PlyFileImpl::read_header_element(ByteSource & tokens)
+{
+    const char * first = nullptr, * last = nullptr;
+    std::string name;
+    if (tokens.next_token(first, last)) name.assign(first, last);
+    uint64_t count = 0;
+    if (tokens.next_token(first, last)) parse_digits(first, last, count);
+    elements.emplace_back(name, static_cast<size_t>(count));
+}
+
+void PlyFile::PlyFileImpl::read_header_property(ByteSource & tokens)
+{
+    if (!elements.size()) throw std::runtime_error("no elements defined; file is malformed");
+    // A missing token reads as an empty one
+    const char * first = nullptr, * last = nullptr;
+    auto next = [&]() { if (!tokens.next_token(first, last)) first = last = nullptr; };
+    next();
+    Type listType = Type::INVALID;
+    const bool isList = token_is(first, last, "list", 4);
+    if (isList)
+    {
+        next();
+        listType = property_type_from_string(first, last);
+        next();
+    }
+    const Type type = property_type_from_string(first, last);
+    next();
+    std::string name(first, last);
+    if (isList) elements.back().properties.emplace_back(listType, type, name, 0);
+    else elements.back().properties.emplace_back(type, name);
+}
+
+size_t PlyFile::PlyFileImpl::read_property_binary(const size_t & stride, void * dest, size_t & destOffset, size_t destSize, ByteSource & src)
+{
+    if (destOffset + stride > destSize)
+    {
+        throw std::runtime_error("unexpected EOF. malformed file?");
+    }
+
+    destOffset += stride;
+    std::memcpy(dest, src.take(stride), stride);
+    return stride;
+}
+
+size_t PlyFile::PlyFileImpl::read_property_ascii(const Type & t, const size_t & stride, void * dest, size_t & destOffset, size_t destSize, ByteSource & src)
+{
+    if (destOffset + stride > destSize)
+    {
+        throw std::runtime_error("unexpected EOF. malformed file?");
+    }
+
+    const char * first, * last;
+    if (!src.next_token(first, last)) throw std::runtime_error("unexpected EOF. malformed file?");
+    if (!parse_ascii_value(t, first, last, dest)) throw std::runtime_error("malformed ascii value: " + std::string(first, last));
+
+    destOffset += stride;
+    return stride;
+}
+
+// Reads `count` values of type `from` and stores them as `to`. Binary values are byte-swapped
+// first if need be; ascii values are parsed as `from`, so that both encodings convert alike.
+size_t PlyFile::PlyFileImpl::read_property_converted(const Type from, const Type to, const size_t count, void * dest, size_t & destOffset, size_t destSize, ByteSource & src)
+{
+    const size_t bytes = count * type_stride(to);
+    if (destOffset + bytes > destSize)
+    {
+        throw std::runtime_error("unexpected EOF. malformed file?");
+    }
+
+    uint8_t * out = static_cast<uint8_t *>(dest);
+    if (isBinary)
+    {
+        convert_strided(from, to, out, 0, src.take(count * type_stride(from)), 0, 1, count, isBigEndian);
+    }
+    else
+    {
+        uint64_t value = 0; // suitably aligned for any property type
+        size_t dummyOffset = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            read_property_ascii(from, type_stride(from), &value, dummyOffset, std::numeric_limits<size_t>::max(), src);
+            convert_strided(from, to, out + i * type_stride(to), 0, reinterpret_cast<const uint8_t *>(&value), 0, 1, 1, false);
+        }
+    }
+
+    destOffset += bytes;
+    return bytes;
+}
+
+void PlyFile::PlyFileImpl::read(std::istream & is)
+{
+    ByteSource src(is);
+    read(src);
+}
+
+void PlyFile::PlyFileImpl::read(const uint8_t * data, const size_t size, std::shared_ptr<const MappedFile> owner)
+{
+    if (size < payloadOffset) throw std::runtime_error("unexpected EOF. malformed file?");
+    read_payload(data + payloadOffset, size - payloadOffset, owner);
+}
+
+void PlyFile::PlyFileImpl::read_payload(const uint8_t * payload, const size_t size, std::shared_ptr<const MappedFile> owner)
+{
+    ByteSource src(payload, size);
+    src.mapping = owner;
+    read(src);
+}
+
+// Sets the worker count for the duration of a parallel read
+struct ThreadCountScope
+{
+    size_t & ref;
+    ThreadCountScope(size_t & r, const size_t n) : ref(r) { ref = n ? n : std::max<size_t>(1, std::thread::hardware_concurrency()); }
+    ~ThreadCountScope() { ref = 1; }
+};
+
+void PlyFile::PlyFileImpl::read_parallel(const uint8_t * data, const size_t size, const size_t thread_count)
+{
+    ThreadCountScope scope(threadCount, thread_count);
+    read(data, size);
+}
+
+void PlyFile::PlyFileImpl::read_parallel(const size_t thread_count)
+{
+    ThreadCountScope scope(threadCount, thread_count);
+    read_mapped();
+}
+
+void PlyFile::PlyFileImpl::read_parallel(std::istream & is, const size_t thread_count)
+{
+    if (isBinary)
+    {
+        read(is);
+        return;
+    }
+
+    // Rows have to be located in memory before they can be handed out
+    std::vector<uint8_t> payload((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+    ThreadCountScope scope(threadCount, thread_count);
+    read_payload(payload.data(), payload.size(), nullptr);
+}
+
+// Parses a list-free ascii element held in memory on `threadCount` threads. By convention each
+// row sits on its own line, so the element can be partitioned at newlines and every chunk parsed
+// independently into its slice of the destination buffers. Every row is checked to have been
+// exactly one line; if that does not hold (blank lines, rows wrapped over several lines), nothing
+// is committed and false is returned so the caller can parse the element serially instead.
+bool PlyFile::PlyFileImpl::parse_ascii_element_parallel(const PlyElement & element, const std::vector<PropertyLookup> & lookups, ByteSource & src)
+{
+    if (element.size == 0) return true; // no rows, and so no chunks to hand out
+    const uint8_t * ptr = src.cursor;
+    const uint8_t * const end = src.end;
+    while (ptr < end && is_ascii_space(*ptr)) ++ptr;
+
+    // Where each destination column of a row lands
+    struct Column { Type t; Type to; size_t stride; uint8_t * dst; size_t dst_stride; };
+    std::unordered_map<PlyDataCursor *, size_t> row_bytes, dst_stride, dst_offset;
+    for (auto & f : lookups) if (!f.skip) row_bytes[f.helper->cursor.get()] += f.dst_stride;
+    for (auto & f : lookups) if (!f.skip) dst_stride[f.helper->cursor.get()] = f.helper->stride ? f.helper->stride : row_bytes[f.helper->cursor.get()];
+
+    std::vector<Column> columns;
+    for (size_t j = 0; j < lookups.size(); ++j)
+    {
+        const PropertyLookup & f = lookups[j];
+        const Type t = element.properties[j].propertyType;
+        Column c = { t, f.skip ? t : f.helper->data->t, f.dst_stride, nullptr, 0 };
+        if (!f.skip)
+        {
+            PlyDataCursor * cursor = f.helper->cursor.get();
+            if (element.size && cursor->byteOffset + (element.size - 1) * dst_stride[cursor] + row_bytes[cursor] > f.helper->data->buffer.size_bytes()) return false;
+            c.dst = f.helper->data->buffer.get() + cursor->byteOffset + dst_offset[cursor];
+            c.dst_stride = dst_stride[cursor];
+            dst_offset[cursor] += f.dst_stride;
+        }
+        columns.push_back(c);
+    }
+
+    // Find the first line of every chunk, and the end of the element
+    const size_t chunk_count = std::max<size_t>(1, std::min(threadCount, element.size / 1024));
+    const size_t rows_per_chunk = (element.size + chunk_count - 1) / chunk_count;
+    std::vector<const uint8_t *> chunk_begin;
+    for (size_t row = 0; row < element.size; ++row)
+    {
+        if (row % rows_per_chunk == 0) chunk_begin.push_back(ptr);
+        const uint8_t * eol = static_cast<const uint8_t *>(std::memchr(ptr, '\n', end - ptr));
+        if (!eol && row + 1 < element.size) return false;
+        ptr = eol ? eol + 1 : end;
+    }
+    chunk_begin.push_back(ptr);
+
+    std::vector<char> chunk_ok(chunk_begin.size() - 1, 0);
+    auto parse_chunk = [&](const size_t chunk)
+    {
+        const char * first, * last;
+        size_t dummyOffset = 0;
+        const uint8_t * p = chunk_begin[chunk];
+        const uint8_t * const chunk_end = chunk_begin[chunk + 1];
+        try
+        {
+            for (size_t row = chunk * rows_per_chunk; p < chunk_end && row < element.size; ++row)
+            {
+                const uint8_t * eol = static_cast<const uint8_t *>(std::memchr(p, '\n', chunk_end - p));
+                if (!eol) eol = chunk_end;
+                ByteSource line(p, static_cast<size_t>(eol - p));
+                for (auto & c : columns)
+                {
+                    if (!c.dst) line.skip_tokens(1);
+                    else if (c.t != c.to) read_property_converted(c.t, c.to, 1, c.dst + row * c.dst_stride, dummyOffset, std::numeric_limits<size_t>::max(), line);
+                    else read_property_ascii(c.t, c.stride, c.dst + row * c.dst_stride, dummyOffset, std::numeric_limits<size_t>::max(), line);
+                }
+                if (line.next_token(first, last)) return;
+                p = eol + (eol < chunk_end ? 1 : 0);
+            }
+            chunk_ok[chunk] = 1;
+        }
+        catch (...) {}
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t chunk = 1; chunk < chunk_ok.size(); ++chunk) workers.emplace_back(parse_chunk, chunk);
+    parse_chunk(0);
+    for (auto & w : workers) w.join();
+
+    for (auto ok : chunk_ok) if (!ok) return false;
+
+    for (auto & d : dst_stride) d.first->byteOffset += element.size * d.second;
+    src.cursor = ptr;
+    return true;
+}
+
+bool PlyFile::PlyFileImpl::open_mapped(const std::string & path)
+{
+    mapping = std::make_shared<const MappedFile>(path);
+    return parse_header(mapping->data, mapping->size);
+}
+
+void PlyFile::PlyFileImpl::read_mapped()
+{
+    if (!mapping) throw std::runtime_error("no file has been mapped; call open_mapped(...) first");
+    read(mapping->data, mapping->size, mapping);
+}
+
+// Buffers come from the file's arena, if it has one, and from the heap otherwise. The elements
+// of a parallel read may allocate at the same time; the arena locks itself.
+inline Buffer allocate_buffer(const std::shared_ptr<PlyArena> & arena, const size_t bytes, AllocationCounter * counter)
+{
+    if (counter) counter->add(bytes);
+    if (!arena) return Buffer(bytes);
+    return Buffer(arena->allocate(bytes), bytes, arena);
+}
+
+// Without a hint or the sidecar index, the length of every list is only learned as it is read.
+// Such groups start out with room for `initial_list_length` values per list and grow while rows
+// are decoded: to what the rows so far project for the whole element, and by at least half again,
+// so that a single pass suffices even for streams that cannot seek. Memory provided by the caller
+// never grows; it is bounds-checked where it is written instead.
+static const size_t initial_list_length = 3;
+
+inline void reserve_row_bytes(PlyFile::PlyFileImpl::ParsingHelper & helper, const std::shared_ptr<PlyArena> & arena, AllocationCounter * counter, const size_t bytes, const size_t row, const size_t rows)
+{
+    PlyData & data = *helper.data;
+    const size_t used = helper.cursor->byteOffset;
+    if (used + bytes <= data.buffer.size_bytes() || helper.stride) return;
+
+    const double projected = static_cast<double>(used + bytes) * static_cast<double>(rows) / static_cast<double>(row + 1) * 1.0625;
+    size_t capacity = std::max(data.buffer.size_bytes() + data.buffer.size_bytes() / 2, used + bytes);
+    if (projected > static_cast<double>(capacity)) capacity = static_cast<size_t>(projected);
+
+    Buffer grown = allocate_buffer(arena, capacity, counter);
+    if (used) std::memcpy(grown.get(), data.buffer.get(), used);
+    data.buffer = std::move(grown);
+}
+
+// Trims a grown (or generously hinted) buffer to the `used` bytes decoded into it. A little slack,
+// or any in an arena, is only hidden rather than paying for a copy.
+inline void fit_buffer(PlyData & data, const size_t used, const std::shared_ptr<PlyArena> & arena, AllocationCounter * counter)
+{
+    const size_t capacity = data.buffer.size_bytes();
+    if (used >= capacity) return;
+    if (arena || capacity - used <= capacity / 8)
+    {
+        data.buffer.shrink(used);
+        return;
+    }
+    if (counter) counter->add(used);
+    Buffer exact(used);
+    if (used) std::memcpy(exact.get(), data.buffer.get(), used);
+    data.buffer = std::move(exact);
+}
+
+void PlyFile::PlyFileImpl::read_range(const std::string & elementKey, const size_t row_begin, const size_t row_count)
+{
+    if (!mapping) throw std::runtime_error("no file has been mapped; call open_mapped(...) first");
+    if (mapping->size < payloadOffset) throw std::runtime_error("unexpected EOF. malformed file?");
+    ByteSource src(mapping->data + payloadOffset, mapping->size - payloadOffset);
+    src.mapping = mapping;
+    read_range(src, elementKey, row_begin, row_count);
+}
+
+void PlyFile::PlyFileImpl::read_range(const uint8_t * data, const size_t size, const std::string & elementKey, const size_t row_begin, const size_t row_count)
+{
+    if (size < payloadOffset) throw std::runtime_error("unexpected EOF. malformed file?");
+    ByteSource src(data + payloadOffset, size - payloadOffset);
+    read_range(src, elementKey, row_begin, row_count);
+}
+
+void PlyFile::PlyFileImpl::read_range(std::istream & is, const std::string & elementKey, const size_t row_begin, const size_t row_count)
+{
+    is.clear();
+    is.seekg(static_cast<std::streamoff>(payloadOffset));
+    if (!is) throw std::runtime_error("read_range(...) requires a seekable stream holding the entire file");
+    ByteSource src(is);
+    read_range(src, elementKey, row_begin, row_count);
+}
+
+// Skips over whole rows of an element without decoding any of them
+void PlyFile::PlyFileImpl::skip_rows(ByteSource & src, const size_t element_idx, const size_t row_count)
+{
+    const DecodePlan & plan = decodePlans[element_idx];
+    if (plan.fixed_stride)
+    {
+        src.skip(row_count * plan.row_stride);
+        return;
+    }
+    std::vector<PropertyLookup> skipped = lookupTable[element_idx];
+    for (auto & f : skipped) f.skip = true;
+    PlyElement element = elements[element_idx];
+    parse_rows(element, skipped, plan, src, row_count, nullptr);
+}
+
+// Positions `src` at the start of a row, from the nearest offset known ahead of it
+void PlyFile::PlyFileImpl::seek_row(ByteSource & src, const size_t element_idx, const size_t row)
+{
+    size_t known = element_idx;
+    while (elementOffsets[known] < 0) --known; // the first element always starts the payload
+    src.seek(static_cast<size_t>(elementOffsets[known]) - payloadOffset);
+    for (; known < element_idx; ++known)
+    {
+        skip_rows(src, known, elements[known].size);
+        elementOffsets[known + 1] = static_cast<int64_t>(payloadOffset + src.tell());
+    }
+
+    const DecodePlan & plan = decodePlans[element_idx];
+    if (plan.fixed_stride)
+    {
+        src.skip(row * plan.row_stride);
+        return;
+    }
+
+    size_t first = 0;
+    const ElementIndex & index = elementIndex[element_idx];
+    if (index.complete && !index.checkpoints.empty())
+    {
+        const size_t c = std::min(row / index_checkpoint_rows, index.checkpoints.size() - 1);
+        src.seek(static_cast<size_t>(index.checkpoints[c]) - payloadOffset);
+        first = c * index_checkpoint_rows;
+    }
+    skip_rows(src, element_idx, row - first);
+}
+
+void PlyFile::PlyFileImpl::read_range(ByteSource & src, const std::string & elementKey, const size_t row_begin, const size_t row_count)
+{
+    if (!isBinary) throw std::runtime_error("read_range(...) requires a binary file; ascii rows cannot be located without parsing");
+    const int64_t element_idx = find_element(elementKey, elements);
+    if (element_idx < 0) throw std::invalid_argument("the element key was not found in the header: " + elementKey);
+    PlyElement & element = elements[element_idx];
+    if (row_begin > element.size || row_count > element.size - row_begin) throw std::invalid_argument("rows requested beyond the end of element: " + elementKey);
+
+    compile_requests();
+    std::vector<PropertyLookup> & lookups = lookupTable[element_idx];
+    const DecodePlan & plan = decodePlans[element_idx];
+    bool requested = false;
+    for (auto & f : lookups) requested |= !f.skip;
+    if (!requested) throw std::invalid_argument("no properties were requested from element: " + elementKey);
+
+    seek_row(src, static_cast<size_t>(element_idx), row_begin);
+
+    if (src.is_span() && is_aliasable(plan))
+    {
+        const size_t bytes = row_count * plan.row_stride;
+        PlyData & data = *plan.ops.front().helper->data;
+        data.buffer = Buffer(src.take(bytes), bytes, src.mapping);
+        data.count = row_count;
+        return;
+    }
+
+    // Only this element's groups are rewound and sized, for the window alone
+    std::unordered_map<PlyData*, ParsingHelper *> groups;
+    for (auto & f : lookups)
+    {
+        if (f.skip) continue;
+        if (groups.insert(std::make_pair(f.helper->data.get(), f.helper)).second) f.helper->cursor->byteOffset = f.helper->cursor->totalSizeBytes = 0;
+        f.helper->data->count = row_count;
+        const size_t list_length = f.list_stride ? (f.helper->list_size_hint ? f.helper->list_size_hint : initial_list_length) : 1;
+        f.helper->cursor->totalSizeBytes += row_count * f.dst_stride * list_length;
+    }
+    for (auto & g : groups)
+    {
+        if (g.second->stride) continue;
+        if (!g.first->buffer.reuse(g.second->cursor->totalSizeBytes)) g.first->buffer = allocate_buffer(arena, g.second->cursor->totalSizeBytes, nullptr);
+    }
+
+    // Rows are decoded into a copy of the element, so that the header keeps describing the whole file
+    PlyElement window = element;
+    window.size = row_count;
+    parse_rows(window, lookups, plan, src, row_count, nullptr);
+
+    for (auto & g : groups)
+    {
+        ParsingHelper & helper = *g.second;
+        PlyData & data = *g.first;
+        if (isBigEndian && !plan.fixed_stride && !helper.convert)
+        {
+            const size_t width = type_stride(data.t);
+            size_t group_size = 0;
+            for (auto & f : lookups) if (!f.skip && f.helper->data.get() == &data) ++group_size;
+            if (helper.stride && !data.isList) swap_rows(data.buffer.get(), data.count, group_size * width, helper.stride, width);
+            else swap_bytes(data.buffer.get(), helper.cursor->byteOffset / width, width);
+        }
+        if (!helper.stride) fit_buffer(data, helper.cursor->byteOffset, arena, nullptr);
+    }
+}
+
+void PlyFile::PlyFileImpl::compile_requests()
+{
+    if (lookupTable.size() == elements.size() && decodePlans.size() == elements.size()) return;
+    lookupTable = make_property_lookup_table();
+    decodePlans = make_decode_plan(lookupTable);
+}
+
+// Matches the header at the start of `data` against `headerLines`, line by line, and learns the element
+// counts and comments along the way. Nothing is changed unless the whole header matches.
+bool PlyFile::PlyFileImpl::match_header(const char * data, const size_t size, size_t & header_bytes)
+{
+    std::vector<size_t> counts;
+    std::vector<std::string> new_comments, new_objInfo;
+    const char * p = data;
+    const char * const end = data + size;
+    size_t line_idx = 0;
+    while (line_idx < headerLines.size())
+    {
+        if (p == end) return false;
+        const char * eol = static_cast<const char *>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        if (!eol) eol = end;
+        const size_t length = static_cast<size_t>(eol - p);
+        const char * line = p;
+        p = (eol < end) ? eol + 1 : end;
+
+        if (length >= 7 && std::memcmp(line, "comment", 7) == 0) { new_comments.push_back(std::string(line, length).erase(0, 8)); continue; }
+        if (length >= 8 && std::memcmp(line, "obj_info", 8) == 0) { new_objInfo.push_back(std::string(line, length).erase(0, 9)); continue; }
+        size_t blank = 0;
+        while (blank < length && is_ascii_space(static_cast<uint8_t>(line[blank]))) ++blank;
+        if (blank == length) continue;
+
+        const HeaderLine & h = headerLines[line_idx++];
+        if (!h.element)
+        {
+            if (length != h.text.size() || std::memcmp(line, h.text.data(), length) != 0) return false;
+            continue;
+        }
+
+        // An element line, whose count may differ
+        if (length <= h.text.size() || std::memcmp(line, h.text.data(), h.text.size()) != 0) return false;
+        const char * first = line + h.text.size();
+        const char * last = line + length;
+        while (last > first && is_ascii_space(static_cast<uint8_t>(last[-1]))) --last;
+        uint64_t count = 0;
+        const size_t digits = parse_digits(first, last, count);
+        if (digits == 0 || digits > 19 || first != last) return false;
+        counts.push_back(static_cast<size_t>(count));
+    }
+    if (counts.size() != elements.size()) return false;
+
+    for (size_t i = 0; i < elements.size(); ++i) elements[i].size = counts[i];
+    comments.swap(new_comments);
+    objInfo.swap(new_objInfo);
+    header_bytes = static_cast<size_t>(p - data);
+    return true;
+}
+
+// What belongs to the previous file alone is dropped
+void PlyFile::PlyFileImpl::start_next_file(const size_t header_bytes)
+{
+    payloadOffset = header_bytes;
+    compute_element_offsets();
+    indexPath.clear();
+    mapping.reset();
+}
+
+bool PlyFile::PlyFileImpl::read_next(const uint8_t * data, const size_t size)
+{
+    const auto t0 = std::chrono::steady_clock::now();
+    size_t header_bytes = 0;
+    if (!match_header(reinterpret_cast<const char *>(data), size, header_bytes)) return false;
+    start_next_file(header_bytes);
+    if (stats) stats->header_ms = elapsed_ms(t0);
+    read(data, size);
+    return true;
+}
+
+bool PlyFile::PlyFileImpl::read_next(std::istream & is)
+{
+    // Lines are gathered up to `end_header`, which is what `match_header` expects to find last
+    const auto t0 = std::chrono::steady_clock::now();
+    std::string header, line;
+    size_t lines = 0;
+    while (lines < headerLines.size() && std::getline(is, line))
+    {
+        size_t blank = 0;
+        while (blank < line.size() && is_ascii_space(static_cast<uint8_t>(line[blank]))) ++blank;
+        const bool ignored = blank == line.size() || line.compare(0, 7, "comment") == 0 || line.compare(0, 8, "obj_info") == 0;
+        if (!ignored) ++lines;
+        header += line;
+        if (!is.eof()) header += '\n';
+    }
+
+    size_t header_bytes = 0;
+    if (!match_header(header.data(), header.size(), header_bytes)) return false;
+    start_next_file(header_bytes);
+    if (stats) stats->header_ms = elapsed_ms(t0);
+    ByteSource src(is);
+    read(src);
+    return true;
+}
+
+void PlyFile::PlyFileImpl::read(ByteSource & src)
+{
+    const auto t0 = std::chrono::steady_clock::now();
+    if (stats)
+    {
+        const double header_ms = stats->header_ms;
+        *stats = PlyReadStats();
+        stats->header_ms = header_ms;
+        stats->elements.resize(elements.size());
+        for (size_t i = 0; i < elements.size(); ++i) stats->elements[i].name = elements[i].name;
+        allocationCounter.allocations = 0;
+        allocationCounter.bytes = 0;
+    }
+
+    // Everything from a previous read is rewound; buffers are kept for reuse below
+    compile_requests();
+    std::vector<std::vector<PropertyLookup>> & element_property_lookup = lookupTable;
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        for (auto & f : element_property_lookup[i])
+        {
+            if (f.skip) continue;
+            f.helper->cursor->byteOffset = f.helper->cursor->totalSizeBytes = 0;
+            f.helper->data->count = elements[i].size;
+        }
+    }
+
+    // The sidecar index knows the exact size of every list. Otherwise, list groups are sized by
+    // their hint, or by `initial_list_length`, and grow as they are read; see `reserve_row_bytes`.
+    if (!apply_index())
+    {
+        for (size_t i = 0; i < elements.size(); ++i)
+        {
+            for (auto & f : element_property_lookup[i])
+            {
+                if (f.skip) continue;
+                const size_t list_length = f.list_stride ? (f.helper->list_size_hint ? f.helper->list_size_hint : initial_list_length) : 1;
+                f.helper->cursor->totalSizeBytes += elements[i].size * f.dst_stride * list_length;
+            }
+        }
+    }
+
+    // Groups which will be served as views into a memory span do not need a buffer. Groups of
+    // list-free elements are byte-swapped while they are decoded rather than afterwards.
+    std::unordered_map<PlyData*, bool> aliased, swapped;
+    for (auto & plan : decodePlans)
+    {
+        if (src.is_span() && is_aliasable(plan)) aliased[plan.ops.front().helper->data.get()] = true;
+        if (plan.fixed_stride) for (auto & op : plan.ops) swapped[op.helper->data.get()] = true;
+    }
+
+    // Group-requested properties share one PlyData and cursor, so each group is allocated once
+    std::unordered_map<PlyData*, size_t> unique_data_count;
+    std::vector<ParsingHelper *> owned;
+    for (auto & entry : userData)
+    {
+        PlyData * data = entry.data.get();
+        if (unique_data_count[data]++ == 0 && !aliased.count(data) && !entry.stride)
+        {
+            if (!data->buffer.reuse(entry.cursor->totalSizeBytes)) data->buffer = allocate_buffer(arena, entry.cursor->totalSizeBytes, allocations());
+            owned.push_back(&entry);
+        }
+    }
+
+    // Populate the data
+    auto t1 = std::chrono::steady_clock::now();
+    if (stats) stats->setup_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    parse_data(src);
+    if (stats) stats->decode_ms = elapsed_ms(t1);
+
+    // In-place big-endian to little-endian swapping of the remaining groups, if required
+    t1 = std::chrono::steady_clock::now();
+    if (isBigEndian)
+    {
+        for (auto & entry : userData)
+        {
+            const ParsingHelper & helper = entry;
+            PlyData * data = helper.data.get();
+            if (helper.convert || !swapped.insert(std::make_pair(data, true)).second) continue;
+            const size_t width = type_stride(data->t);
+            if (helper.stride && !data->isList) swap_rows(data->buffer.get(), data->count, unique_data_count[data] * width, helper.stride, width);
+            else swap_bytes(data->buffer.get(), helper.cursor->byteOffset / width, width);
+        }
+    }
+    if (stats) stats->swap_ms = elapsed_ms(t1);
+
+    t1 = std::chrono::steady_clock::now();
+    for (auto * helper : owned) fit_buffer(*helper->data, helper->cursor->byteOffset, arena, allocations());
+    if (!indexPath.empty() && indexDirty) save_index();
+
+    if (stats)
+    {
+        stats->finish_ms = elapsed_ms(t1);
+        stats->total_ms = elapsed_ms(t0);
+        stats->allocations = allocationCounter.allocations;
+        stats->bytes_allocated = allocationCounter.bytes;
+        statsSink(*stats);
+        *stats = PlyReadStats();
+    }
+}
+
+void PlyFile::PlyFileImpl::write(std::ostream & os, bool _isBinary)
+{
+    for (auto & d : userData) { d.cursor->byteOffset = 0; }
+    if (_isBinary)
+    {
+        isBinary = true;
+        isBigEndian = writeBigEndian;
+        write_binary_internal(os);
+    }
+    else
+    {
+        isBinary = false;
+        isBigEndian = false;
+        write_ascii_internal(os);
+    }
+}
+
+void PlyFile::PlyFileImpl::write_parallel(std::ostream & os, bool _isBinary, const size_t thread_count)
+{
+    ThreadCountScope scope(threadCount, thread_count);
+    write(os, _isBinary);
+}
+
+void PlyFile::PlyFileImpl::set_ascii_precision(const int decimals)
+{
+    if (decimals < -1 || decimals > 17) throw std::invalid_argument("ascii precision must be between 0 and 17 decimals, or -1");
+    asciiDecimals = decimals;
+}
+
+void PlyFile::PlyFileImpl::set_big_endian(const bool bigEndian)
+{
+    writeBigEndian = bigEndian;
+}
+
+void PlyFile::PlyFileImpl::set_stats_sink(std::function<void(const PlyReadStats &)> sink)
+{
+    statsSink = std::move(sink);
+    if (!statsSink) stats.reset();
+    else if (!stats) stats.reset(new PlyReadStats());
+}
+
+// Lists with row offsets are written with the length of each row, others with the header's fixed length
+inline size_t list_length(const PlyData & data, const size_t row, const PlyProperty & p)
+{
+    if (data.offsetStride == 0) return p.listCount;
+    return static_cast<size_t>(data.list_offset(row + 1) - data.list_offset(row));
+}
+
+// Where a property finds its values in the buffer of its group, for any row: through the row
+// offsets of a group that has them, otherwise at a fixed place in rows of a fixed size
+struct WriteColumn
+{
+    const PlyProperty * property;
+    const PlyData * data;
+    size_t prop_stride;
+    size_t list_stride;
+    size_t row_bytes; // of the group, unless it has row offsets
+    size_t offset;    // of the property within a row of its group
+
+    const uint8_t * values(const size_t row) const
+    {
+        if (data->offsetStride) return data->buffer.get_const() + static_cast<size_t>(data->list_offset(row)) * prop_stride;
+        return data->buffer.get_const() + row * row_bytes + offset;
+    }
+
+    size_t length(const size_t row) const { return property->isList ? list_length(*data, row, *property) : 1; }
+};
+
+inline std::vector<WriteColumn> make_write_columns(const PlyElement & e, const std::vector<PlyFile::PlyFileImpl::PropertyLookup> & lookups)
+{
+    std::vector<WriteColumn> columns;
+    std::unordered_map<const PlyData *, size_t> group_row_bytes;
+    for (size_t j = 0; j < lookups.size(); ++j)
+    {
+        const PlyFile::PlyFileImpl::PropertyLookup & f = lookups[j];
+        if (f.skip || f.helper == nullptr) continue;
+        const PlyProperty & p = e.properties[j];
+        const PlyData * data = f.helper->data.get();
+        size_t & row_bytes = group_row_bytes[data];
+        columns.push_back(WriteColumn{ &p, data, f.prop_stride, f.list_stride, 0, row_bytes });
+        row_bytes += f.prop_stride * (p.isList ? p.listCount : 1);
+    }
+    for (auto & c : columns) c.row_bytes = group_row_bytes[c.data];
+    return columns;
+}
+
+// With `swap`, list lengths and values are byte-swapped in the block after they are copied
+inline void write_binary_rows(BlockWriter & out, const std::vector<WriteColumn> & columns, const size_t first_row, const size_t row_count, const bool swap)
+{
+    for (size_t row = first_row; row < first_row + row_count; ++row)
+    {
+        for (const WriteColumn & c : columns)
+        {
+            const size_t length = c.length(row);
+            const size_t bytes = c.prop_stride * length;
+            char * dst = out.reserve(c.list_stride + bytes);
+            if (c.property->isList)
+            {
+                const uint64_t count = length;
+                std::memcpy(dst, &count, c.list_stride);
+                if (swap) swap_bytes(reinterpret_cast<uint8_t *>(dst), 1, c.list_stride);
+                dst += c.list_stride;
+            }
+            std::memcpy(dst, c.values(row), bytes);
+            if (swap) swap_bytes(reinterpret_cast<uint8_t *>(dst), length, c.prop_stride);
+            out.commit(dst + bytes);
+        }
+    }
+}
+
+// A run of adjacent properties of one group, copied into list-free rows of `row_stride` bytes
+struct WriteGather { const uint8_t * src; size_t src_stride; size_t dst_offset; size_t size; size_t width; };
+
+// With `swap`, the gathered rows are byte-swapped in the block: all at once if every value has the
+// same width, otherwise run by run
+inline void write_gathered_rows(BlockWriter & out, const std::vector<WriteGather> & gathers, const size_t row_stride, const size_t first_row, const size_t row_count, const bool swap)
+{
+    bool uniform = true;
+    for (auto & g : gathers) uniform &= g.width == gathers.front().width;
+
+    const size_t block_rows = std::max<size_t>(1, BlockWriter::block_bytes / row_stride);
+    for (size_t row = first_row; row < first_row + row_count; row += block_rows)
+    {
+        const size_t count = std::min(block_rows, first_row + row_count - row);
+        char * dst = out.reserve(count * row_stride);
+        for (auto & g : gathers) copy_strided(reinterpret_cast<uint8_t *>(dst) + g.dst_offset, row_stride, g.src + row * g.src_stride, g.src_stride, count, g.size);
+        if (swap && uniform) swap_bytes(reinterpret_cast<uint8_t *>(dst), count * row_stride / gathers.front().width, gathers.front().width);
+        else if (swap) for (auto & g : gathers) swap_rows(reinterpret_cast<uint8_t *>(dst) + g.dst_offset, count, g.size, row_stride, g.width);
+        out.commit(dst + count * row_stride);
+    }
+}
+
+// Encodes `rows` rows through `encode(writer, first_row, row_count)`. With several threads, a large
+// element is cut into ranges of rows that are encoded concurrently, each into a block of its own;
+// the blocks then leave in order, a couple of ranges per thread at a time.
+void PlyFile::PlyFileImpl::encode_rows(BlockWriter & out, const size_t rows, const std::function<void(BlockWriter &, size_t, size_t)> & encode) noexcept
+{
+    const size_t range_rows = std::min<size_t>(65536, std::max<size_t>(4096, rows / (threadCount * 4)));
+    if (threadCount <= 1 || rows <= range_rows || !out.os)
+    {
+        encode(out, 0, rows);
+        return;
+    }
+
+    out.flush();
+    const size_t range_count = (rows + range_rows - 1) / range_rows;
+    std::vector<BlockWriter> blocks(std::min(range_count, threadCount * 2));
+    for (size_t first = 0; first < range_count; first += blocks.size())
+    {
+        const size_t last = std::min(range_count, first + blocks.size());
+        std::atomic<size_t> next(first);
+        auto work = [&]()
+        {
+            for (size_t r = next++; r < last; r = next++)
+            {
+                BlockWriter & block = blocks[r - first];
+                block.used = 0;
+                encode(block, r * range_rows, std::min(range_rows, rows - r * range_rows));
+            }
+        };
+        std::vector<std::thread> workers;
+        for (size_t w = 1; w < std::min(threadCount, last - first); ++w) workers.emplace_back(work);
+        work();
+        for (auto & w : workers) w.join();
+        for (size_t r = first; r < last; ++r) out.os->write(blocks[r - first].block.data(), blocks[r - first].used);
+    }
+}
+
+// Rows are assembled in the blocks of a `BlockWriter` and leave it in large writes. List-free rows
+// are gathered from their groups with one strided copy per run of adjacent properties of the same
+// group, and an element that is a single group, in file order, is written straight from its buffer.
+// Big-endian rows are always gathered, and swapped in the block, so caller buffers stay untouched.
+void PlyFile::PlyFileImpl::write_binary_internal(std::ostream & os) noexcept
+{
+    isBinary = true;
+
+    write_header(os);
+
+    auto element_property_lookup = make_property_lookup_table();
+    BlockWriter out(os);
+
+    for (size_t element_idx = 0; element_idx < elements.size(); ++element_idx)
+    {
+        const PlyElement & e = elements[element_idx];
+        const std::vector<WriteColumn> columns = make_write_columns(e, element_property_lookup[element_idx]);
+        if (columns.empty() || e.size == 0) continue;
+
+        bool has_lists = false;
+        for (const WriteColumn & c : columns) has_lists |= c.property->isList;
+        if (has_lists)
+        {
+            encode_rows(out, e.size, [&](BlockWriter & w, size_t first_row, size_t row_count) { write_binary_rows(w, columns, first_row, row_count, isBigEndian); });
+            continue;
+        }
+
+        std::vector<WriteGather> gathers;
+        size_t row_stride = 0;
+        for (const WriteColumn & c : columns)
+        {
+            const uint8_t * src = c.values(0);
+            if (!gathers.empty() && gathers.back().src + gathers.back().size == src && gathers.back().src_stride == c.row_bytes) gathers.back().size += c.prop_stride;
+            else gathers.push_back(WriteGather{ src, c.row_bytes, row_stride, c.prop_stride, c.prop_stride });
+            row_stride += c.prop_stride;
+        }
+
+        const bool swap = isBigEndian && gathers.front().width > 1;
+        if (gathers.size() == 1 && gathers.front().src_stride == row_stride && !swap)
+        {
+            out.flush();
+            os.write(reinterpret_cast<const char *>(gathers.front().src), e.size * row_stride);
+        }
+        else encode_rows(out, e.size, [&](BlockWriter & w, size_t first_row, size_t row_count) { write_gathered_rows(w, gathers, row_stride, first_row, row_count, isBigEndian); });
+    }
+    out.flush();
+}
+
+void PlyFile::PlyFileImpl::write_ascii_rows(BlockWriter & out, const std::vector<WriteColumn> & columns, const size_t first_row, const size_t row_count) noexcept
+{
+    for (size_t row = first_row; row < first_row + row_count; ++row)
+    {
+        for (const WriteColumn & c : columns)
+        {
+            const size_t length = c.length(row);
+            const uint8_t * src = c.values(row);
+            if (c.property->isList)
+            {
+                char * ptr = format_uint(length, out.reserve(max_ascii_value_bytes));
+                *ptr++ = ' ';
+                out.commit(ptr);
+            }
+            for (size_t j = 0; j < length; ++j)
+            {
+                char * ptr = format_ascii_value(c.property->propertyType, src + j * c.prop_stride, asciiDecimals, out.reserve(max_ascii_value_bytes));
+                *ptr++ = ' ';
+                out.commit(ptr);
+            }
+        }
+        out.put('\n');
+    }
+}
+
+void PlyFile::PlyFileImpl::write_ascii_internal(std::ostream & os) noexcept
+{
+    write_header(os);
+
+    auto element_property_lookup = make_property_lookup_table();
+    BlockWriter out(os);
+
+    for (size_t element_idx = 0; element_idx < elements.size(); ++element_idx)
+    {
+        const PlyElement & e = elements[element_idx];
+        const std::vector<WriteColumn> columns = make_write_columns(e, element_property_lookup[element_idx]);
+        encode_rows(out, e.size, [&](BlockWriter & w, size_t first_row, size_t row_count) { write_ascii_rows(w, columns, first_row, row_count); });
+    }
+    out.flush();
+}
+
+void PlyFile::PlyFileImpl::write_header(std::ostream & os) noexcept
 {
     const std::locale & fixLoc = std::locale("C");
     os.imbue(fixLoc);
 
-    os << "ply\n";
-    if (isBinary) os << ((isBigEndian) ? "format binary_big_endian 1.0" : "format binary_little_endian 1.0") << "\n";
-    else os << "format ascii 1.0\n";
+    os << "ply\n";
+    if (isBinary) os << ((isBigEndian) ? "format binary_big_endian 1.0" : "format binary_little_endian 1.0") << "\n";
+    else os << "format ascii 1.0\n";
+
+    for (const auto & comment : comments) os << "comment " << comment << "\n";
+
+    auto property_lookup = make_property_lookup_table();
+
+    size_t element_idx = 0;
+    for (auto & e : elements)
+    {
+        os << "element " << e.name << " " << e.size << "\n";
+        size_t property_idx = 0;
+        for (const auto & p : e.properties)
+        {
+            PropertyLookup & lookup = property_lookup[element_idx][property_idx];
+
+            if (!lookup.skip)
+            {
+                if (p.isList)
+                {
+                    os << "property list " << type_name(p.listType) << " "
+                       << type_name(p.propertyType) << " " << p.name << "\n";
+                }
+                else
+                {
+                    os << "property " << type_name(p.propertyType) << " " << p.name << "\n";
+                }
+            }
+            property_idx++;
+        }
+        element_idx++;
+    }
+    os << "end_header\n";
+}
+
+std::shared_ptr<PlyData> PlyFile::PlyFileImpl::request_properties_from_element(const std::string & elementKey,
+    const std::vector<std::string> propertyKeys,
+    const uint32_t list_size_hint, const Type targetType)
+{
+    if (elements.empty()) throw std::runtime_error("header had no elements defined. malformed file?");
+    if (elementKey.empty()) throw std::invalid_argument("`elementKey` argument is empty");
+    if (propertyKeys.empty()) throw std::invalid_argument("`propertyKeys` argument is empty");
+
+    std::shared_ptr<PlyData> out_data = std::make_shared<PlyData>();
+
+    const int64_t elementIndex = find_element(elementKey, elements);
+
+    std::vector<std::string> keys_not_found;
+
+    // Sanity check if the user requested element is in the pre-parsed header
+    if (elementIndex >= 0)
+    {
+        // We found the element
+        const PlyElement & element = elements[elementIndex];
+
+        // Each key in `propertyKey` gets an entry into the userData table (addressed by
+        // element and property index), but groups of properties (requested from the
+        // public api through this function) all share the same `ParsingHelper`. When it comes
+        // time to .read(), we check the number of unique PlyData shared pointers
+        // and allocate a single buffer that will be used by each property key group.
+        // That way, properties like, {"x", "y", "z"} will all be put into the same buffer.
+
+        ParsingHelper helper;
+        helper.data = out_data;
+        helper.data->count = element.size; // how many items are in the element?
+        helper.data->isList = false;
+        helper.data->t = Type::INVALID;
+        helper.cursor = std::make_shared<PlyDataCursor>();
+        helper.list_size_hint = list_size_hint;
+
+        // Find each of the keys
+        for (const auto & key : propertyKeys)
+        {
+            const int64_t propertyIndex = find_property(key, element.properties);
+            if (propertyIndex < 0) keys_not_found.push_back(key);
+        }
+
+        if (keys_not_found.size())
+        {
+            std::stringstream ss;
+            for (auto & str : keys_not_found) ss << str << ", ";
+            throw std::invalid_argument("the following property keys were not found in the header: " + ss.str());
+        }
+
+        // Sanity check that all properties share the same type, unless they are converted to one
+        std::vector<Type> propertyTypes;
+        for (const auto & key : propertyKeys)
+        {
+            const int64_t propertyIndex = find_property(key, element.properties);
+            const PlyProperty & property = element.properties[propertyIndex];
+            propertyTypes.push_back(property.propertyType);
+        }
+
+        if (targetType == Type::INVALID && std::adjacent_find(propertyTypes.begin(), propertyTypes.end(), std::not_equal_to<Type>()) != propertyTypes.end())
+        {
+            throw std::invalid_argument("all requested properties must share the same type.");
+        }
+
+        // With a target type, every property of the group is converted to it as it is read
+        if (targetType != Type::INVALID)
+        {
+            for (const auto & key : propertyKeys) helper.convert |= (element.properties[find_property(key, element.properties)].propertyType != targetType);
+        }
+
+        lookupTable.clear();
+        decodePlans.clear();
+        for (const auto & key : propertyKeys)
+        {
+            const int64_t propertyIndex = find_property(key, element.properties);
+            const PlyProperty & property = element.properties[propertyIndex];
+            helper.data->t = (targetType == Type::INVALID) ? property.propertyType : targetType;
+            helper.data->isList = property.isList;
+            if (!insert_request(static_cast<size_t>(elementIndex), static_cast<size_t>(propertyIndex), helper))
+            {
+                throw std::invalid_argument("element-property key has already been requested: " + element.name + " " + property.name);
+            }
+        }
+    }
+    else throw std::invalid_argument("the element key was not found in the header: " + elementKey);
+
+    return out_data;
+}
+
+std::shared_ptr<PlyData> PlyFile::PlyFileImpl::request_properties_from_element(const std::string & elementKey,
+    const std::vector<std::string> propertyKeys, uint8_t * destination, const size_t capacity, const size_t stride, const Type targetType)
+{
+    if (destination == nullptr) throw std::invalid_argument("`destination` argument is null");
+
+    std::shared_ptr<PlyData> out_data = request_properties_from_element(elementKey, propertyKeys, 0, targetType);
+
+    const size_t row_bytes = propertyKeys.size() * type_stride(out_data->t);
+    if (out_data->isList && stride != 0) throw std::invalid_argument("list properties can only be read into a packed destination");
+    if (stride != 0 && stride < row_bytes) throw std::invalid_argument("`stride` is smaller than the requested properties of a row");
+    if (!out_data->isList && out_data->count && (out_data->count - 1) * (stride ? stride : row_bytes) + row_bytes > capacity)
+    {
+        throw std::invalid_argument("`capacity` is too small for element " + elementKey);
+    }
+
+    for (auto & entry : userData) if (entry.data == out_data) entry.stride = stride ? stride : row_bytes;
+    out_data->buffer = Buffer(destination, capacity);
+    return out_data;
+}
+
+std::vector<std::shared_ptr<PlyData>> PlyFile::PlyFileImpl::request_columns_from_element(const std::string & elementKey,
+    const std::vector<std::string> propertyKeys, const Type targetType, const uint32_t list_size_hint)
+{
+    std::vector<std::shared_ptr<PlyData>> columns;
+    for (const auto & key : propertyKeys) columns.push_back(request_properties_from_element(elementKey, { key }, list_size_hint, targetType));
+    return columns;
+}
+
+void PlyFile::PlyFileImpl::add_properties_to_element(const std::string & elementKey,
+    const std::vector<std::string> propertyKeys,
+    const Type type, const size_t count, const uint8_t * data, const Type listType, const size_t listCount)
+{
+    ParsingHelper helper;
+    helper.data = std::make_shared<PlyData>();
+    helper.data->count = count;
+    helper.data->t = type;
+    helper.data->buffer = Buffer(data); // we should also set size for safety reasons
+    helper.cursor = std::make_shared<PlyDataCursor>();
+
+    auto create_property_on_element = [&](PlyElement & e, const size_t element_idx)
+    {
+        lookupTable.clear();
+        decodePlans.clear();
+        for (auto key : propertyKeys)
+        {
+            PlyProperty newProp = (listType == Type::INVALID) ? PlyProperty(type, key) : PlyProperty(listType, type, key, listCount);
+            insert_request(element_idx, e.properties.size(), helper);
+            e.properties.push_back(newProp);
+        }
+    };
+
+    const int64_t idx = find_element(elementKey, elements);
+    if (idx >= 0)
+    {
+        PlyElement & e = elements[idx];
+        create_property_on_element(e, static_cast<size_t>(idx));
+    }
+    else
+    {
+        PlyElement newElement = (listType == Type::INVALID) ? PlyElement(elementKey, count) : PlyElement(elementKey, count);
+        create_property_on_element(newElement, elements.size());
+        elements.push_back(newElement);
+    }
+}
+
+void PlyFile::PlyFileImpl::add_list_property_to_element(const std::string & elementKey, const std::string & propertyKey,
+    const Type type, const size_t count, const uint8_t * data, const Type listType, const uint8_t * offsets, const size_t offsetStride)
+{
+    if (offsets == nullptr) throw std::invalid_argument("`offsets` argument is null");
+    add_properties_to_element(elementKey, { propertyKey }, type, count, data, listType, 0);
+    PlyData & out_data = *userData.back().data;
+    out_data.isList = true;
+    out_data.offsets = Buffer(offsets, (count + 1) * offsetStride);
+    out_data.offsetStride = offsetStride;
+}
+
+// The list length prefix is flipped immediately after reading, since (unlike the payload
+// which is swapped as a post-process) we need the correct little-endian count to continue.
+size_t PlyFile::PlyFileImpl::read_list_size_binary(const Type & t, const size_t & stride, ByteSource & src)
+{
+    const uint8_t * ptr = src.take(stride);
+    switch (t)
+    {
+    case Type::INT8:   return static_cast<size_t>(*reinterpret_cast<const int8_t *>(ptr));
+    case Type::UINT8:  return static_cast<size_t>(*ptr);
+    case Type::INT16:  { int16_t v;  std::memcpy(&v, ptr, 2); return static_cast<size_t>(isBigEndian ? endian_swap<int16_t, int16_t>(v) : v); }
+    case Type::UINT16: { uint16_t v; std::memcpy(&v, ptr, 2); return static_cast<size_t>(isBigEndian ? endian_swap<uint16_t, uint16_t>(v) : v); }
+    case Type::INT32:  { int32_t v;  std::memcpy(&v, ptr, 4); return static_cast<size_t>(isBigEndian ? endian_swap<int32_t, int32_t>(v) : v); }
+    case Type::UINT32: { uint32_t v; std::memcpy(&v, ptr, 4); return static_cast<size_t>(isBigEndian ? endian_swap<uint32_t, uint32_t>(v) : v); }
+    default: throw std::invalid_argument("invalid ply list size type");
+    }
+}
+
+// Sizes the row offsets of a list group for `rows` rows; they are 64-bit only if the values need it
+inline void begin_list_offsets(PlyData & data, const size_t rows, const std::shared_ptr<PlyArena> & arena, AllocationCounter * counter)
+{
+    const size_t stride = (data.buffer.size_bytes() / type_stride(data.t) > std::numeric_limits<uint32_t>::max()) ? 8 : 4;
+    if (data.offsetStride != stride || data.offsets.size_bytes() != (rows + 1) * stride) data.offsets = allocate_buffer(arena, (rows + 1) * stride, counter);
+    data.offsetStride = stride;
+    std::memset(data.offsets.get(), 0, stride);
+}
+
+inline void store_list_offset(PlyData & data, const size_t row, const uint64_t offset, const std::shared_ptr<PlyArena> & arena, AllocationCounter * counter)
+{
+    // A buffer grown past 2^32 - 1 values switches to 64-bit offsets
+    if (data.offsetStride == 4 && offset > std::numeric_limits<uint32_t>::max())
+    {
+        const size_t entries = data.offsets.size_bytes() / 4;
+        Buffer wide = allocate_buffer(arena, entries * 8, counter);
+        for (size_t i = 0; i < entries; ++i)
+        {
+            uint32_t v;
+            std::memcpy(&v, data.offsets.get() + i * 4, 4);
+            const uint64_t w = v;
+            std::memcpy(wide.get() + i * 8, &w, 8);
+        }
+        data.offsets = std::move(wide);
+        data.offsetStride = 8;
+    }
+
+    if (data.offsetStride == 8) std::memcpy(data.offsets.get() + row * 8, &offset, 8);
+    else
+    {
+        const uint32_t v = static_cast<uint32_t>(offset);
+        std::memcpy(data.offsets.get() + row * 4, &v, 4);
+    }
+}
 
-    for (const auto & comment : comments) os << "comment " << comment << "\n";
+// Binary elements without lists have the same layout in every row, so the property lookup
+// table for such an element can be compiled down to a short list of byte-range copies per row.
+// Adjacent properties bound for the same buffer (e.g. "x y z") are coalesced into one copy, and
+// skipped properties cost nothing at all.
+std::vector<PlyFile::PlyFileImpl::DecodePlan> PlyFile::PlyFileImpl::make_decode_plan(const std::vector<std::vector<PropertyLookup>> & element_property_lookup)
+{
+    std::vector<DecodePlan> plans(elements.size());
+
+    for (size_t element_idx = 0; element_idx < elements.size(); ++element_idx)
+    {
+        DecodePlan & plan = plans[element_idx];
+        const std::vector<PropertyLookup> & lookups = element_property_lookup[element_idx];
+
+        plan.fixed_stride = isBinary;
+        for (auto & f : lookups) plan.fixed_stride &= (f.list_stride == 0);
+        if (!plan.fixed_stride) continue;
+
+        // Bytes each destination receives per row
+        std::unordered_map<PlyDataCursor *, size_t> row_bytes;
+        for (auto & f : lookups) if (!f.skip) row_bytes[f.helper->cursor.get()] += f.dst_stride;
+
+        // Values of converted groups are copied one type pair at a time
+        std::unordered_map<PlyDataCursor *, size_t> dst_offset;
+        for (size_t j = 0; j < lookups.size(); ++j)
+        {
+            const PropertyLookup & f = lookups[j];
+            if (!f.skip)
+            {
+                PlyDataCursor * cursor = f.helper->cursor.get();
+                const Type from = f.helper->convert ? elements[element_idx].properties[j].propertyType : Type::INVALID;
+                if (!plan.ops.empty() && plan.ops.back().helper->cursor.get() == cursor && plan.ops.back().src_offset + plan.ops.back().size == plan.row_stride && plan.ops.back().from == from)
+                {
+                    plan.ops.back().size += f.prop_stride;
+                }
+                else
+                {
+                    CopyOp op;
+                    op.helper = f.helper;
+                    op.src_offset = plan.row_stride;
+                    op.dst_offset = dst_offset[cursor];
+                    op.dst_stride = f.helper->stride ? f.helper->stride : row_bytes[cursor];
+                    op.size = f.prop_stride;
+                    op.from = from;
+                    op.to = f.helper->data->t;
+                    plan.ops.push_back(op);
+                }
+                dst_offset[cursor] += f.dst_stride;
+            }
+            plan.row_stride += f.prop_stride;
+        }
+
+        for (auto & r : row_bytes)
+        {
+            for (auto & op : plan.ops)
+            {
+                if (op.helper->cursor.get() != r.first) continue;
+                Destination d;
+                d.helper = op.helper;
+                d.row_bytes = r.second;
+                d.stride = op.dst_stride;
+                plan.destinations.push_back(d);
+                break;
+            }
+        }
+    }
+
+    return plans;
+}
+
+// An element can be handed back as a view into a memory span (rather than copied) if a
+// single property group covers all of its properties, because the resulting buffer
+// is then byte-identical to the element's rows in the file.
+bool PlyFile::PlyFileImpl::is_aliasable(const DecodePlan & plan) const
+{
+    return plan.fixed_stride && !isBigEndian && plan.ops.size() == 1 && plan.ops.front().size == plan.row_stride && plan.ops.front().helper->stride == 0 && !plan.ops.front().helper->convert;
+}
+
+// Executes a plan over `row_count` consecutive rows starting at `rows`, one destination
+// column at a time. Destination bounds must have been validated by the caller; see
+// `decode_fixed_stride_element`.
+void PlyFile::PlyFileImpl::decode_rows(const DecodePlan & plan, const uint8_t * rows, const size_t row_count, uint8_t * const * dst) noexcept
+{
+    for (size_t op_idx = 0; op_idx < plan.ops.size(); ++op_idx)
+    {
+        const CopyOp & op = plan.ops[op_idx];
+        if (op.from != Type::INVALID) convert_strided(op.from, op.to, dst[op_idx], op.dst_stride, rows + op.src_offset, plan.row_stride, row_count, op.size / type_stride(op.from), isBigEndian);
+        else if (op.size == plan.row_stride && op.size == op.dst_stride) std::memcpy(dst[op_idx], rows, row_count * op.size);
+        else copy_strided(dst[op_idx], op.dst_stride, rows + op.src_offset, plan.row_stride, row_count, op.size);
+    }
+}
+
+// A single bounds check per destination covers every row
+void PlyFile::PlyFileImpl::check_fixed_stride_bounds(const DecodePlan & plan, const size_t row_count) const
+{
+    for (auto & d : plan.destinations)
+    {
+        if (row_count && d.helper->cursor->byteOffset + (row_count - 1) * d.stride + d.row_bytes > d.helper->data->buffer.size_bytes())
+        {
+            throw std::runtime_error("unexpected EOF. malformed file?");
+        }
+    }
+}
+
+// Decodes rows [first_row, first_row + row_count) of an element, counted from the cursors of its
+// destinations, out of `rows`. Big-endian values are swapped a block at a time, while the block is
+// still in cache. Cursors are left alone, so that ranges of one element may be decoded concurrently.
+void PlyFile::PlyFileImpl::decode_row_range(const DecodePlan & plan, const uint8_t * rows, const size_t first_row, const size_t row_count)
+{
+    std::vector<uint8_t *> dst(plan.ops.size());
+    for (size_t op_idx = 0; op_idx < plan.ops.size(); ++op_idx)
+    {
+        const CopyOp & op = plan.ops[op_idx];
+        dst[op_idx] = op.helper->data->buffer.get() + op.helper->cursor->byteOffset + first_row * op.dst_stride + op.dst_offset;
+    }
+
+    const size_t block_rows = isBigEndian ? std::max<size_t>(1, swap_block_bytes / plan.row_stride) : row_count;
+    for (size_t row = 0; row < row_count; row += block_rows)
+    {
+        const size_t block_count = std::min(block_rows, row_count - row);
+        decode_rows(plan, rows + row * plan.row_stride, block_count, dst.data());
+        for (size_t op_idx = 0; op_idx < plan.ops.size(); ++op_idx) dst[op_idx] += block_count * plan.ops[op_idx].dst_stride;
+
+        if (isBigEndian)
+        {
+            for (auto & d : plan.destinations)
+            {
+                if (d.helper->convert) continue; // swapped while converting
+                swap_rows(d.helper->data->buffer.get() + d.helper->cursor->byteOffset + (first_row + row) * d.stride, block_count, d.row_bytes, d.stride, type_stride(d.helper->data->t));
+            }
+        }
+    }
+}
+
+void PlyFile::PlyFileImpl::decode_fixed_stride_rows(const DecodePlan & plan, ByteSource & src, const size_t row_count)
+{
+    check_fixed_stride_bounds(plan, row_count);
+
+    // Nothing requested: one skip over all of the rows
+    if (plan.ops.empty())
+    {
+        src.skip(row_count * plan.row_stride);
+        return;
+    }
+
+    // Spans are decoded in place in one go. Streams are pulled in blocks of whole rows, each
+    // with a single read, so that the staging window stays bounded for very large elements.
+    const size_t block_rows = src.is_span() ? row_count : std::max<size_t>(1, bulk_read_bytes / plan.row_stride);
+    for (size_t row = 0; row < row_count; row += block_rows)
+    {
+        const size_t block_count = std::min(block_rows, row_count - row);
+        decode_row_range(plan, src.take(block_count * plan.row_stride), row, block_count);
+    }
+
+    for (auto & d : plan.destinations) d.helper->cursor->byteOffset += row_count * d.stride;
+}
+
+// Decodes the binary elements of a memory span on `threadCount` threads. Every requested element
+// whose offset is known before it is reached (from the header, or the sidecar index) becomes a task
+// of its own, except that list-free elements are split into ranges of rows; an element with lists is
+// walked by a single task. Idle workers take the largest task left. Returns the index of the first
+// element that was not decoded, with `src` at its start, for the caller to go on serially.
+size_t PlyFile::PlyFileImpl::decode_binary_elements_parallel(ByteSource & src, const size_t element_end)
+{
+    struct Task
+    {
+        size_t element;
+        size_t first_row;
+        size_t row_count;
+        size_t bytes;
+    };
+    std::vector<Task> tasks;
+    std::vector<const uint8_t *> starts(element_end, nullptr), ends(element_end, nullptr);
+    std::vector<char> walked(element_end, 0); // elements with lists that a task walks
+
+    const uint8_t * const payload = src.cursor - src.tell();
+    size_t first_unknown = 0;
+    for (; first_unknown < element_end; ++first_unknown)
+    {
+        const size_t i = first_unknown;
+        if (elementOffsets[i] < static_cast<int64_t>(payloadOffset) || static_cast<size_t>(elementOffsets[i]) - payloadOffset > static_cast<size_t>(src.end - payload)) break;
+        starts[i] = payload + (static_cast<size_t>(elementOffsets[i]) - payloadOffset);
+
+        const DecodePlan & plan = decodePlans[i];
+        bool requested = false;
+        for (auto & f : lookupTable[i]) requested |= !f.skip;
+
+        if (plan.fixed_stride)
+        {
+            const size_t element_bytes = elements[i].size * plan.row_stride;
+            if (static_cast<size_t>(src.end - starts[i]) < element_bytes) throw std::runtime_error("unexpected EOF. malformed file?");
+            ends[i] = starts[i] + element_bytes;
+            if (!requested || is_aliasable(plan)) continue;
+
+            // Ranges of at least a megabyte, and a few per worker to even out the load
+            check_fixed_stride_bounds(plan, elements[i].size);
+            const size_t range_rows = std::max<size_t>(std::max<size_t>(1, (1 << 20) / plan.row_stride), (elements[i].size + threadCount * 4 - 1) / (threadCount * 4));
+            for (size_t row = 0; row < elements[i].size; row += range_rows)
+            {
+                const size_t count = std::min(range_rows, elements[i].size - row);
+                tasks.push_back(Task{ i, row, count, count * plan.row_stride });
+            }
+            continue;
+        }
+
+        // Where an element with lists ends is only learned by walking it, unless the next offset is known
+        const bool next_known = i + 1 < elements.size() && elementOffsets[i + 1] >= elementOffsets[i] && static_cast<size_t>(elementOffsets[i + 1]) - payloadOffset <= static_cast<size_t>(src.end - payload);
+        if (next_known) ends[i] = payload + (static_cast<size_t>(elementOffsets[i + 1]) - payloadOffset);
+        if (requested)
+        {
+            walked[i] = 1;
+            tasks.push_back(Task{ i, 0, elements[i].size, static_cast<size_t>((next_known ? ends[i] : src.end) - starts[i]) });
+        }
+        if (!next_known)
+        {
+            if (requested) ++first_unknown;
+            break;
+        }
+    }
+
+    if (tasks.size() < 2) return 0;
+
+    for (size_t i = 0; i < first_unknown; ++i)
+    {
+        if (is_aliasable(decodePlans[i])) decodePlans[i].ops.front().helper->data->buffer = Buffer(starts[i], static_cast<size_t>(ends[i] - starts[i]), src.mapping);
+    }
+
+    for (size_t i = 0; i < first_unknown; ++i)
+    {
+        if (!walked[i]) continue;
+        ElementIndex & index = elementIndex[i];
+        if (!indexPath.empty() && !index.complete)
+        {
+            index.lists.assign(elements[i].properties.size(), ListStats());
+            index.checkpoints.clear();
+        }
+    }
+
+    std::sort(tasks.begin(), tasks.end(), [](const Task & a, const Task & b) { return a.bytes > b.bytes; });
+    std::atomic<size_t> next_task(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    std::vector<double> decode_ms(first_unknown, 0.0); // for `stats`, under `error_mutex`
+    auto work = [&]()
+    {
+        for (size_t t = next_task++; t < tasks.size(); t = next_task++)
+        {
+            const Task & task = tasks[t];
+            const DecodePlan & plan = decodePlans[task.element];
+            const auto t0 = std::chrono::steady_clock::now();
+            try
+            {
+                if (plan.fixed_stride) decode_row_range(plan, starts[task.element] + task.first_row * plan.row_stride, task.first_row, task.row_count);
+                else
+                {
+                    ByteSource rows = src;
+                    rows.cursor = starts[task.element];
+                    ElementIndex & index = elementIndex[task.element];
+                    const bool indexing = !indexPath.empty() && !index.complete;
+                    parse_rows(elements[task.element], lookupTable[task.element], plan, rows, elements[task.element].size, indexing ? &index : nullptr);
+                    ends[task.element] = rows.cursor;
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) error = std::current_exception();
+            }
+            if (stats)
+            {
+                const double ms = elapsed_ms(t0);
+                std::lock_guard<std::mutex> lock(error_mutex);
+                decode_ms[task.element] += ms;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t w = 1; w < std::min(threadCount, tasks.size()); ++w) workers.emplace_back(work);
+    work();
+    for (auto & w : workers) w.join();
+    if (error) std::rethrow_exception(error);
+
+    for (size_t i = 0; i < first_unknown; ++i)
+    {
+        const DecodePlan & plan = decodePlans[i];
+        if (plan.fixed_stride && !is_aliasable(plan)) for (auto & d : plan.destinations) d.helper->cursor->byteOffset += elements[i].size * d.stride;
+        if (walked[i] && !indexPath.empty() && !elementIndex[i].complete)
+        {
+            elementIndex[i].complete = true;
+            indexDirty = true;
+        }
+        if (stats) note_element(i, static_cast<size_t>(ends[i] - starts[i]), decode_ms[i]);
+    }
+
+    src.cursor = ends[first_unknown - 1];
+    return first_unknown;
+}
+
+void PlyFile::PlyFileImpl::parse_rows(PlyElement & element, std::vector<PropertyLookup> & lookups, const DecodePlan & plan,
+    ByteSource & src, const size_t row_count, ElementIndex * index)
+{
+    if (plan.fixed_stride)
+    {
+        // Page in requested rows ahead of decoding them
+        if (!plan.ops.empty()) src.will_need(row_count * plan.row_stride);
+        decode_fixed_stride_rows(plan, src, row_count);
+        return;
+    }
+
+    size_t listSize = 0;
+    uint32_t asciiListSize = 0;
+    size_t dummyCount = 0;
+    ParsingHelper * helper {nullptr};
+
+    // Rows of a caller's array of structs are further apart than the properties read into them
+    std::vector<std::pair<PlyDataCursor *, size_t>> row_gaps;
+    {
+        std::unordered_map<PlyDataCursor *, size_t> row_bytes, strides;
+        for (auto & f : lookups)
+        {
+            if (f.skip || !f.helper->stride) continue;
+            row_bytes[f.helper->cursor.get()] += f.dst_stride;
+            strides[f.helper->cursor.get()] = f.helper->stride;
+        }
+        for (auto & r : row_bytes) if (strides[r.first] > r.second) row_gaps.push_back(std::make_pair(r.first, strides[r.first] - r.second));
+    }
+
+    // Groups with lists record where each row begins; see `PlyData::offsets`
+    std::vector<ParsingHelper *> list_groups;
+    for (auto & f : lookups)
+    {
+        if (f.skip || !f.list_stride) continue;
+        bool seen = false;
+        for (auto * g : list_groups) seen |= (g->data == f.helper->data);
+        if (!seen) list_groups.push_back(f.helper);
+    }
+    for (auto * g : list_groups) begin_list_offsets(*g->data, row_count, arena, allocations());
+    std::vector<uint8_t> list_state(element.properties.size(), 0); // per property: 0 unseen, 1 uniform so far, 2 varying
+
+    for (size_t count = 0; count < row_count; ++count)
+    {
+        if (index && count % index_checkpoint_rows == 0) index->checkpoints.push_back(payloadOffset + src.tell());
+
+        size_t property_idx = 0;
+        for (auto & property : element.properties)
+        {
+            PropertyLookup & lookup = lookups[property_idx];
+            helper = lookup.helper;
+
+            if (isBinary)
+            {
+                if (property.isList) listSize = read_list_size_binary(property.listType, lookup.list_stride, src);
+                const size_t bytes = property.isList ? lookup.prop_stride * listSize : lookup.prop_stride;
+                if (!lookup.skip) reserve_row_bytes(*helper, arena, allocations(), bytes / lookup.prop_stride * lookup.dst_stride, count, row_count);
+
+                if (lookup.skip) src.skip(bytes);
+                else if (helper->convert)
+                {
+                    read_property_converted(property.propertyType, helper->data->t, bytes / lookup.prop_stride, helper->data->buffer.get() + helper->cursor->byteOffset, helper->cursor->byteOffset, helper->data->buffer.size_bytes(), src);
+                }
+                else
+                {
+                    read_property_binary(bytes, helper->data->buffer.get() + helper->cursor->byteOffset, helper->cursor->byteOffset, helper->data->buffer.size_bytes(), src);
+                }
+            }
+            else
+            {
+                if (property.isList)
+                {
+                    dummyCount = 0;
+                    asciiListSize = 0;
+                    read_property_ascii(property.listType, lookup.list_stride, &asciiListSize, dummyCount, sizeof(asciiListSize), src);
+                    listSize = asciiListSize;
+                }
+                const size_t tokens = property.isList ? listSize : 1;
+                if (!lookup.skip) reserve_row_bytes(*helper, arena, allocations(), tokens * lookup.dst_stride, count, row_count);
+
+                if (lookup.skip) src.skip_tokens(tokens);
+                else if (property.propertyType != helper->data->t)
+                {
+                    read_property_converted(property.propertyType, helper->data->t, tokens, helper->data->buffer.get() + helper->cursor->byteOffset, helper->cursor->byteOffset, helper->data->buffer.size_bytes(), src);
+                }
+                else
+                {
+                    for (size_t i = 0; i < tokens; ++i)
+                    {
+                        read_property_ascii(property.propertyType, lookup.prop_stride, helper->data->buffer.get() + helper->cursor->byteOffset, helper->cursor->byteOffset, helper->data->buffer.size_bytes(), src);
+                    }
+                }
+            }
+
+            if (index && property.isList)
+            {
+                ListStats & l = index->lists[property_idx];
+                l.total += listSize;
+                l.min = std::min<uint64_t>(l.min, listSize);
+                l.max = std::max<uint64_t>(l.max, listSize);
+            }
+
+            if (!lookup.skip && property.isList)
+            {
+                // Recorded in the header so that it can be written back out again (e.g. transcoding)
+                uint8_t & state = list_state[property_idx];
+                if (state == 0) { property.listCount = listSize; state = 1; }
+                else if (state == 1 && property.listCount != listSize) { property.listCount = 0; state = 2; }
+            }
+            property_idx++;
+        }
+        for (auto & gap : row_gaps) gap.first->byteOffset += gap.second;
+        for (auto * g : list_groups) store_list_offset(*g->data, count + 1, g->cursor->byteOffset / type_stride(g->data->t), arena, allocations());
+    }
+}
+
+void PlyFile::PlyFileImpl::parse_data(ByteSource & src)
+{
+    compile_requests();
+    std::vector<std::vector<PropertyLookup>> & element_property_lookup = lookupTable;
+    // Nothing after the last requested element needs to be read at all
+    size_t element_end = 0;
+    for (size_t i = 0; i < element_property_lookup.size(); ++i)
+    {
+        for (auto & f : element_property_lookup[i]) if (!f.skip) element_end = i + 1;
+    }
+
+    // Binary elements held in memory may be decoded concurrently, as far as their offsets are known
+    size_t element_idx = 0;
+    if (isBinary && threadCount > 1 && src.is_span()) element_idx = decode_binary_elements_parallel(src, element_end);
+
+    // This is the inner import loop
+    for (; element_idx < element_end; ++element_idx)
+    {
+        if (!stats)
+        {
+            parse_element(element_idx, src);
+            continue;
+        }
+        const size_t from = src.tell();
+        const auto t0 = std::chrono::steady_clock::now();
+        parse_element(element_idx, src);
+        note_element(element_idx, src.tell() - from, elapsed_ms(t0));
+    }
+}
+
+void PlyFile::PlyFileImpl::note_element(const size_t element_idx, const size_t bytes, const double ms)
+{
+    bool requested = false;
+    for (auto & f : lookupTable[element_idx]) requested |= !f.skip;
+    PlyReadStats::Element & e = stats->elements[element_idx];
+    if (requested)
+    {
+        e.rows_decoded += elements[element_idx].size;
+        e.bytes_read += bytes;
+    }
+    else e.bytes_skipped += bytes;
+    e.decode_ms += ms;
+}
+
+void PlyFile::PlyFileImpl::parse_element(const size_t element_idx, ByteSource & src)
+{
+    std::vector<std::vector<PropertyLookup>> & element_property_lookup = lookupTable;
+    const std::vector<DecodePlan> & plans = decodePlans;
+    PlyElement & element = elements[element_idx];
+    const DecodePlan & plan = plans[element_idx];
+    elementOffsets[element_idx] = static_cast<int64_t>(payloadOffset + src.tell());
+
+    // Whole-element views into a memory span; see `is_aliasable`
+    if (src.is_span() && is_aliasable(plan))
+    {
+        const size_t element_bytes = element.size * plan.row_stride;
+        const uint8_t * rows = src.take(element_bytes);
+        plan.ops.front().helper->data->buffer = Buffer(rows, element_bytes, src.mapping);
+        return;
+    }
+
+    if (plan.fixed_stride)
+    {
+        parse_rows(element, element_property_lookup[element_idx], plan, src, element.size, nullptr);
+        return;
+    }
+
+    // Walking an element with lists is the only way to learn its layout; record it for the sidecar index
+    ElementIndex & index = elementIndex[element_idx];
+    const bool indexing = !indexPath.empty() && !index.complete;
+    if (indexing)
+    {
+        index.lists.assign(element.properties.size(), ListStats());
+        index.checkpoints.clear();
+    }
+
+    // List-free ascii elements held in memory may be split across threads
+    if (!isBinary && threadCount > 1 && src.is_span())
+    {
+        bool list_free = true, requested = false;
+        for (auto & f : element_property_lookup[element_idx]) { list_free &= (f.list_stride == 0); requested |= !f.skip; }
+        if (list_free && requested && parse_ascii_element_parallel(element, element_property_lookup[element_idx], src)) return;
+    }
+
+    parse_rows(element, element_property_lookup[element_idx], plan, src, element.size, indexing ? &index : nullptr);
+
+    if (indexing)
+    {
+        index.complete = true;
+        indexDirty = true;
+    }
+}
+
+void PlyFile::PlyFileImpl::begin_stream(PlyStream::PlyStreamImpl & stream)
+{
+    compile_requests();
+    stream.lookups = lookupTable;
+    stream.plans = decodePlans;
+    for (size_t i = 0; i < stream.lookups.size(); ++i)
+    {
+        for (auto & f : stream.lookups[i]) if (!f.skip) stream.element_end = i + 1;
+    }
+}
+
+// Decodes the next chunk of a stream. The requested groups of the element are rewound to the
+// start of their buffers for every chunk, and those buffers are sized for the chunk: exactly for
+// list-free rows, and as `read` does for lists, growing while the chunk is decoded if need be.
+size_t PlyFile::PlyFileImpl::next_chunk(PlyStream::PlyStreamImpl & stream, const size_t max_rows)
+{
+    if (max_rows == 0) throw std::invalid_argument("`max_rows` must be positive");
+    ByteSource & src = stream.src;
+
+    for (; stream.element_idx < stream.element_end; ++stream.element_idx, stream.row = 0)
+    {
+        PlyElement & element = elements[stream.element_idx];
+        std::vector<PropertyLookup> & lookups = stream.lookups[stream.element_idx];
+        const DecodePlan & plan = stream.plans[stream.element_idx];
+        if (stream.row == 0) elementOffsets[stream.element_idx] = static_cast<int64_t>(payloadOffset + src.tell());
+        if (stream.row == element.size) continue;
+
+        // One representative helper per group, and the bytes each group needs for the chunk
+        const size_t rows = std::min(max_rows, element.size - stream.row);
+        std::vector<ParsingHelper *> groups;
+        std::unordered_map<PlyData *, size_t> row_bytes, chunk_bytes;
+        for (auto & f : lookups)
+        {
+            if (f.skip) continue;
+            PlyData * data = f.helper->data.get();
+            if (!row_bytes.count(data)) groups.push_back(f.helper);
+            row_bytes[data] += f.dst_stride;
+            const size_t list_length = f.list_stride ? (f.helper->list_size_hint ? f.helper->list_size_hint : initial_list_length) : 1;
+            chunk_bytes[data] += rows * f.dst_stride * list_length;
+        }
+
+        if (groups.empty())
+        {
+            parse_rows(element, lookups, plan, src, element.size - stream.row, nullptr);
+            continue;
+        }
+
+        stream.chunk_element = stream.element_idx;
+        stream.chunk_first_row = stream.row;
+        stream.row += rows;
+
+        // Views into a memory span, as for `read`
+        if (src.is_span() && is_aliasable(plan))
+        {
+            PlyData * data = groups.front()->data.get();
+            data->buffer = Buffer(src.take(rows * plan.row_stride), rows * plan.row_stride, src.mapping);
+            data->count = rows;
+            return rows;
+        }
+
+        for (auto * g : groups)
+        {
+            PlyData * data = g->data.get();
+            g->cursor->byteOffset = 0;
+            data->count = rows;
+            if (g->stride) continue; // caller-provided memory; bounds are checked while decoding
+            Buffer & bytes = stream.storage[data];
+            if (bytes.size_bytes() < chunk_bytes[data]) bytes = allocate_buffer(arena, chunk_bytes[data], nullptr);
+            data->buffer = Buffer(bytes.get(), bytes.size_bytes());
+        }
+
+        parse_rows(element, lookups, plan, src, rows, nullptr);
+
+        // Buffers grown while decoding become the storage for later chunks
+        for (auto * g : groups)
+        {
+            PlyData * data = g->data.get();
+            if (g->stride) continue;
+            Buffer & bytes = stream.storage[data];
+            if (data->buffer.get() != bytes.get()) bytes = std::move(data->buffer);
+            data->buffer = Buffer(bytes.get(), g->cursor->byteOffset);
+        }
+
+        // List-free binary rows were swapped while decoding; see `decode_fixed_stride_rows`
+        if (isBigEndian && !plan.fixed_stride)
+        {
+            for (auto * g : groups)
+            {
+                PlyData * data = g->data.get();
+                if (g->convert) continue;
+                const size_t width = type_stride(data->t);
+                if (g->stride && !data->isList) swap_rows(data->buffer.get(), rows, row_bytes[data], g->stride, width);
+                else swap_bytes(data->buffer.get(), g->cursor->byteOffset / width, width);
+            }
+        }
+        return rows;
+    }
+    return 0;
+}
+
+// Drives a stream on behalf of a visitor, one chunk per batch
+bool PlyFile::PlyFileImpl::visit(PlyStream::PlyStreamImpl & stream, PlyVisitor & visitor, const size_t batch_rows)
+{
+    std::vector<std::shared_ptr<PlyData>> columns;
+    while (const size_t rows = next_chunk(stream, batch_rows))
+    {
+        columns.clear();
+        for (auto & f : stream.lookups[stream.chunk_element])
+        {
+            if (!f.skip && std::find(columns.begin(), columns.end(), f.helper->data) == columns.end()) columns.push_back(f.helper->data);
+        }
+        if (!visitor.on_element_batch(elements[stream.chunk_element], columns, stream.chunk_first_row, rows)) return false;
+    }
+    return true;
+}
+
+// Blocks of decompressed bytes are filled by a producer thread and read in order by the parser. The
+// block at `head` is the get area until the next `underflow` hands it back.
+struct PlyDecompressingStream::Impl : public std::streambuf
+{
+    std::unique_ptr<PlyDecompressor> codec;
+    std::vector<Buffer> ring;
+    std::vector<size_t> sizes;
+    size_t head{ 0 }, filled{ 0 };
+    bool reading{ false }, done{ false }, stop{ false };
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::thread producer;
 
-    auto property_lookup = make_property_lookup_table();
+    Impl(std::unique_ptr<PlyDecompressor> _codec, const size_t block_bytes, const size_t ring_blocks)
+        : codec(std::move(_codec)), ring(std::max<size_t>(2, ring_blocks)), sizes(ring.size(), 0)
+    {
+        for (auto & block : ring) block = Buffer(std::max<size_t>(1, block_bytes));
+        producer = std::thread([this]() { produce(); });
+    }
 
-    size_t element_idx = 0;
-    for (auto & e : elements)
+    ~Impl()
     {
-        os << "element " << e.name << " " << e.size << "\n";
-        size_t property_idx = 0;
-        for (const auto & p : e.properties)
         {
-            PropertyLookup & lookup = property_lookup[element_idx][property_idx];
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        changed.notify_all();
+        producer.join();
+    }
 
-            if (!lookup.skip)
+    void produce()
+    {
+        for (;;)
+        {
+            size_t block;
             {
-                if (p.isList)
-                {
-                    os << "property list " << PropertyTable[p.listType].str << " "
-                       << PropertyTable[p.propertyType].str << " " << p.name << "\n";
-                }
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [this]() { return stop || filled < ring.size(); });
+                if (stop) return;
+                block = (head + filled) % ring.size();
+            }
+            size_t size = 0;
+            std::exception_ptr failure;
+            try { size = codec->decompress(ring[block].get(), ring[block].size_bytes()); }
+            catch (...) { failure = std::current_exception(); }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                sizes[block] = size;
+                if (size) ++filled;
                 else
                 {
-                    os << "property " << PropertyTable[p.propertyType].str << " " << p.name << "\n";
+                    done = true;
+                    error = failure;
                 }
             }
-            property_idx++;
+            changed.notify_all();
+            if (!size) return;
         }
-        element_idx++;
     }
-    os << "end_header\n";
-}
-
-std::shared_ptr<PlyData> PlyFile::PlyFileImpl::request_properties_from_element(const std::string & elementKey,
-    const std::vector<std::string> propertyKeys,
-    const uint32_t list_size_hint)
-{
-    if (elements.empty()) throw std::runtime_error("header had no elements defined. malformed file?");
-    if (elementKey.empty()) throw std::invalid_argument("`elementKey` argument is empty");
-    if (propertyKeys.empty()) throw std::invalid_argument("`propertyKeys` argument is empty");
 
-    std::shared_ptr<PlyData> out_data = std::make_shared<PlyData>();
-
-    const int64_t elementIndex = find_element(elementKey, elements);
-
-    std::vector<std::string> keys_not_found;
-
-    // Sanity check if the user requested element is in the pre-parsed header
-    if (elementIndex >= 0)
+    int_type underflow() override
     {
-        // We found the element
-        const PlyElement & element = elements[elementIndex];
+        std::unique_lock<std::mutex> lock(mutex);
+        if (reading)
+        {
+            head = (head + 1) % ring.size();
+            --filled;
+            reading = false;
+            changed.notify_all();
+        }
+        changed.wait(lock, [this]() { return filled > 0 || done; });
+        if (!filled)
+        {
+            if (error) std::rethrow_exception(error);
+            return traits_type::eof();
+        }
+        reading = true;
+        char * block = reinterpret_cast<char *>(ring[head].get());
+        setg(block, block, block + sizes[head]);
+        return traits_type::to_int_type(*block);
+    }
+};
 
-        // Each key in `propertyKey` gets an entry into the userData map (keyed by a hash of
-        // element name and property name), but groups of properties (requested from the
-        // public api through this function) all share the same `ParsingHelper`. When it comes
-        // time to .read(), we check the number of unique PlyData shared pointers
-        // and allocate a single buffer that will be used by each property key group.
-        // That way, properties like, {"x", "y", "z"} will all be put into the same buffer.
+PlyDecompressingStream::PlyDecompressingStream(std::unique_ptr<PlyDecompressor> codec, const size_t block_bytes, const size_t ring_blocks)
+    : std::istream(nullptr), impl(new Impl(std::move(codec), block_bytes, ring_blocks))
+{
+    rdbuf(impl.get());
+    exceptions(std::ios::badbit); // so that codec errors reach the caller rather than ending the stream
+}
 
-        ParsingHelper helper;
-        helper.data = out_data;
-        helper.data->count = element.size; // how many items are in the element?
-        helper.data->isList = false;
-        helper.data->t = Type::INVALID;
-        helper.cursor = std::make_shared<PlyDataCursor>();
-        helper.list_size_hint = list_size_hint;
+PlyDecompressingStream::~PlyDecompressingStream() {}
 
-        // Find each of the keys
-        for (const auto & key : propertyKeys)
+// Reads a file front to back in whole blocks, bypassing any stream buffering, for `PlyPrefetchingStream`
+struct PrefetchFileReader : public PlyDecompressor
+{
+#if defined(_WIN32)
+    HANDLE file{ INVALID_HANDLE_VALUE };
+    explicit PrefetchFileReader(const std::string & path)
+    {
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("could not open file for reading: " + path);
+    }
+    ~PrefetchFileReader() { CloseHandle(file); }
+    size_t decompress(uint8_t * out, const size_t capacity) override
+    {
+        size_t done = 0;
+        while (done < capacity)
         {
-            const int64_t propertyIndex = find_property(key, element.properties);
-            if (propertyIndex < 0) keys_not_found.push_back(key);
+            DWORD n = 0;
+            const DWORD request = static_cast<DWORD>(std::min<size_t>(capacity - done, 1u << 30));
+            if (!ReadFile(file, out + done, request, &n, nullptr)) throw std::runtime_error("could not read file");
+            if (n == 0) break;
+            done += n;
         }
-
-        if (keys_not_found.size())
+        return done;
+    }
+#else
+    int fd{ -1 };
+    explicit PrefetchFileReader(const std::string & path)
+    {
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("could not open file for reading: " + path);
+#if defined(POSIX_FADV_SEQUENTIAL)
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    }
+    ~PrefetchFileReader() { ::close(fd); }
+    size_t decompress(uint8_t * out, const size_t capacity) override
+    {
+        size_t done = 0;
+        while (done < capacity)
         {
-            std::stringstream ss;
-            for (auto & str : keys_not_found) ss << str << ", ";
-            throw std::invalid_argument("the following property keys were not found in the header: " + ss.str());
+            const ssize_t n = ::read(fd, out + done, capacity - done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) throw std::runtime_error("could not read file");
+            if (n == 0) break;
+            done += static_cast<size_t>(n);
         }
+        return done;
+    }
+#endif
+};
 
-        for (const auto & key : propertyKeys)
+PlyPrefetchingStream::PlyPrefetchingStream(const std::string & path, const size_t block_bytes, const size_t ring_blocks)
+    : PlyDecompressingStream(std::unique_ptr<PlyDecompressor>(new PrefetchFileReader(path)), block_bytes, ring_blocks) {}
+
+// Full blocks queue up for a consumer thread that compresses them in order; the block being written
+// is the put area, and is swapped for a free one once it fills.
+struct PlyCompressingStream::Impl : public std::streambuf
+{
+    std::unique_ptr<PlyCompressor> codec;
+    std::vector<std::vector<char>> ring;
+    std::vector<size_t> sizes;
+    size_t head{ 0 }, queued{ 0 }, current{ 0 };
+    bool closing{ false }, closed{ false };
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::thread consumer;
+
+    Impl(std::unique_ptr<PlyCompressor> _codec, const size_t block_bytes, const size_t ring_blocks)
+        : codec(std::move(_codec)), ring(std::max<size_t>(2, ring_blocks), std::vector<char>(std::max<size_t>(1, block_bytes))), sizes(ring.size(), 0)
+    {
+        setp(ring[0].data(), ring[0].data() + ring[0].size());
+        consumer = std::thread([this]() { consume(); });
+    }
+
+    void consume()
+    {
+        for (;;)
         {
-            const int64_t propertyIndex = find_property(key, element.properties);
-            const PlyProperty & property = element.properties[propertyIndex];
-            helper.data->t = property.propertyType;
-            helper.data->isList = property.isList;
-            auto result = userData.insert(std::pair<uint32_t, ParsingHelper>(hash_fnv1a(element.name + property.name), helper));
-            if (result.second == false)
+            size_t block;
             {
-                throw std::invalid_argument("element-property key has already been requested: " + element.name + " " + property.name);
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [this]() { return queued > 0 || closing; });
+                if (!queued) return;
+                block = head;
             }
+            try { if (!error) codec->compress(reinterpret_cast<const uint8_t *>(ring[block].data()), sizes[block]); }
+            catch (...) { error = std::current_exception(); }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                head = (head + 1) % ring.size();
+                --queued;
+            }
+            changed.notify_all();
         }
+    }
 
-        // Sanity check that all properties share the same type
-        std::vector<Type> propertyTypes;
-        for (const auto & key : propertyKeys)
+    // Queues the put area, and makes the next free block the put area
+    void hand_off()
+    {
+        const size_t size = static_cast<size_t>(pptr() - pbase());
+        if (!size) return;
+        std::unique_lock<std::mutex> lock(mutex);
+        sizes[current] = size;
+        ++queued;
+        changed.notify_all();
+        changed.wait(lock, [this]() { return queued < ring.size(); });
+        current = (head + queued) % ring.size();
+        setp(ring[current].data(), ring[current].data() + ring[current].size());
+    }
+
+    int_type overflow(int_type c) override
+    {
+        if (closed) return traits_type::eof();
+        hand_off();
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
         {
-            const int64_t propertyIndex = find_property(key, element.properties);
-            const PlyProperty & property = element.properties[propertyIndex];
-            propertyTypes.push_back(property.propertyType);
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
         }
+        return traits_type::not_eof(c);
+    }
 
-        if (std::adjacent_find(propertyTypes.begin(), propertyTypes.end(), std::not_equal_to<Type>()) != propertyTypes.end())
+    void close()
+    {
+        if (closed) return;
+        closed = true;
+        hand_off();
         {
-            throw std::invalid_argument("all requested properties must share the same type.");
+            std::lock_guard<std::mutex> lock(mutex);
+            closing = true;
         }
+        changed.notify_all();
+        consumer.join();
+        setp(nullptr, nullptr);
+        if (error) std::rethrow_exception(error);
+        codec->finish();
     }
-    else throw std::invalid_argument("the element key was not found in the header: " + elementKey);
+};
 
-    return out_data;
+PlyCompressingStream::PlyCompressingStream(std::unique_ptr<PlyCompressor> codec, const size_t block_bytes, const size_t ring_blocks)
+    : std::ostream(nullptr), impl(new Impl(std::move(codec), block_bytes, ring_blocks))
+{
+    rdbuf(impl.get());
 }
 
-void PlyFile::PlyFileImpl::add_properties_to_element(const std::string & elementKey,
-    const std::vector<std::string> propertyKeys,
-    const Type type, const size_t count, const uint8_t * data, const Type listType, const size_t listCount)
+PlyCompressingStream::~PlyCompressingStream()
 {
-    ParsingHelper helper;
-    helper.data = std::make_shared<PlyData>();
-    helper.data->count = count;
-    helper.data->t = type;
-    helper.data->buffer = Buffer(data); // we should also set size for safety reasons
-    helper.cursor = std::make_shared<PlyDataCursor>();
+    try { impl->close(); }
+    catch (...) {}
+}
+
+void PlyCompressingStream::close()
+{
+    flush();
+    impl->close();
+}
+
+#if defined(TINYPLY_WITH_ZLIB)
+
+struct PlyGzipDecompressor::State
+{
+    std::istream & in;
+    z_stream z;
+    std::vector<uint8_t> input;
+    bool ended{ false };
+    explicit State(std::istream & is) : in(is), input(1 << 16) { std::memset(&z, 0, sizeof(z)); }
+};
 
-    auto create_property_on_element = [&](PlyElement & e)
+PlyGzipDecompressor::PlyGzipDecompressor(std::istream & compressed) : state(new State(compressed))
+{
+    // 15 + 32: the largest window, with gzip or zlib headers detected automatically
+    if (inflateInit2(&state->z, 15 + 32) != Z_OK) throw std::runtime_error("could not initialize zlib inflate");
+}
+
+PlyGzipDecompressor::~PlyGzipDecompressor() { inflateEnd(&state->z); }
+
+size_t PlyGzipDecompressor::decompress(uint8_t * out, const size_t capacity)
+{
+    z_stream & z = state->z;
+    z.next_out = out;
+    z.avail_out = static_cast<uInt>(std::min<size_t>(capacity, std::numeric_limits<uInt>::max()));
+    while (z.avail_out && !state->ended)
     {
-        for (auto key : propertyKeys)
+        if (!z.avail_in)
         {
-            PlyProperty newProp = (listType == Type::INVALID) ? PlyProperty(type, key) : PlyProperty(listType, type, key, listCount);
-            userData.insert(std::pair<uint32_t, ParsingHelper>(hash_fnv1a(elementKey + key), helper));
-            e.properties.push_back(newProp);
+            state->in.read(reinterpret_cast<char *>(state->input.data()), state->input.size());
+            z.next_in = state->input.data();
+            z.avail_in = static_cast<uInt>(state->in.gcount());
+            if (!z.avail_in) throw std::runtime_error("unexpected end of gzip data");
         }
-    };
+        const int result = inflate(&z, Z_NO_FLUSH);
+        if (result == Z_STREAM_END)
+        {
+            // Another gzip member may follow
+            if (!z.avail_in && state->in.peek() == std::char_traits<char>::eof()) state->ended = true;
+            else inflateReset(&z);
+        }
+        else if (result != Z_OK && result != Z_BUF_ERROR) throw std::runtime_error("corrupt gzip data");
+    }
+    return static_cast<size_t>(z.next_out - out);
+}
 
-    const int64_t idx = find_element(elementKey, elements);
-    if (idx >= 0)
+struct PlyGzipCompressor::State
+{
+    std::ostream & out;
+    z_stream z;
+    std::vector<uint8_t> output;
+    explicit State(std::ostream & os) : out(os), output(1 << 16) { std::memset(&z, 0, sizeof(z)); }
+
+    void run(const int flush)
     {
-        PlyElement & e = elements[idx];
-        create_property_on_element(e);
+        int result;
+        do
+        {
+            z.next_out = output.data();
+            z.avail_out = static_cast<uInt>(output.size());
+            result = deflate(&z, flush);
+            if (result == Z_STREAM_ERROR) throw std::runtime_error("zlib deflate failed");
+            out.write(reinterpret_cast<const char *>(output.data()), output.size() - z.avail_out);
+        } while (z.avail_out == 0 || (flush == Z_FINISH && result != Z_STREAM_END));
+        if (!out) throw std::runtime_error("could not write gzip data");
     }
-    else
+};
+
+PlyGzipCompressor::PlyGzipCompressor(std::ostream & compressed, const int level) : state(new State(compressed))
+{
+    // 15 + 16: the largest window, with a gzip header
+    if (deflateInit2(&state->z, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) throw std::runtime_error("could not initialize zlib deflate");
+}
+
+PlyGzipCompressor::~PlyGzipCompressor() { deflateEnd(&state->z); }
+
+void PlyGzipCompressor::compress(const uint8_t * data, const size_t size)
+{
+    for (size_t done = 0; done < size;)
     {
-        PlyElement newElement = (listType == Type::INVALID) ? PlyElement(elementKey, count) : PlyElement(elementKey, count);
-        create_property_on_element(newElement);
-        elements.push_back(newElement);
+        const size_t n = std::min<size_t>(size - done, std::numeric_limits<uInt>::max());
+        state->z.next_in = const_cast<uint8_t *>(data + done);
+        state->z.avail_in = static_cast<uInt>(n);
+        state->run(Z_NO_FLUSH);
+        done += n;
     }
 }
 
-void PlyFile::PlyFileImpl::parse_data(std::istream & is, bool firstPass)
+void PlyGzipCompressor::finish() { state->run(Z_FINISH); }
+
+#endif // end TINYPLY_WITH_ZLIB
+
+// What every exported Arrow array and schema owns, freed by its release callback. Children are
+// released along with their parent, unless a consumer has moved them out (and released them) first.
+struct ArrowArrayHolder
 {
-    std::function<void(PropertyLookup & f, const PlyProperty & p, uint8_t * dest, size_t & destOffset, size_t destSize, std::istream & is)> read;
-    std::function<size_t(PropertyLookup & f, const PlyProperty & p, std::istream & is)> skip;
+    std::vector<const void *> buffers;
+    std::vector<ArrowArray *> children;
+    std::vector<Buffer::Released> memory;
+};
 
-    const auto start = is.tellg();
+struct ArrowSchemaHolder
+{
+    std::string format, name;
+    std::vector<ArrowSchema *> children;
+};
 
-    uint32_t listSize = 0;
-    size_t dummyCount = 0;
-    std::string skip_ascii_buffer;
+inline void release_arrow_array(ArrowArray * array)
+{
+    ArrowArrayHolder * holder = static_cast<ArrowArrayHolder *>(array->private_data);
+    for (auto * child : holder->children)
+    {
+        if (child->release) child->release(child);
+        delete child;
+    }
+    for (auto & m : holder->memory) m.release(m.context);
+    delete holder;
+    array->release = nullptr;
+}
 
-    // Special case mirroring read_property_binary but for list types; this
-    // has an additional big endian check to flip the data in place immediately
-    // after reading. We do this as a performance optimization; endian flipping is
-    // done on regular properties as a post-process after reading (also for optimization)
-    // but we need the correct little-endian list count as we read the file.
-    auto read_list_binary = [this](const Type & t, void * dst, size_t & destOffset, const size_t & stride, std::istream & _is) noexcept
+inline void release_arrow_schema(ArrowSchema * schema)
+{
+    ArrowSchemaHolder * holder = static_cast<ArrowSchemaHolder *>(schema->private_data);
+    for (auto * child : holder->children)
     {
-        destOffset += stride;
-        _is.read((char*)dst, stride);
+        if (child->release) child->release(child);
+        delete child;
+    }
+    delete holder;
+    schema->release = nullptr;
+}
 
-        if (isBigEndian)
-        {
-            switch (t)
-            {
-            case Type::INT16:  *(int16_t*)dst  = endian_swap<int16_t, int16_t>(*(int16_t*)dst);    break;
-            case Type::UINT16: *(uint16_t*)dst = endian_swap<uint16_t, uint16_t>(*(uint16_t*)dst); break;
-            case Type::INT32:  *(int32_t*)dst  = endian_swap<int32_t, int32_t>(*(int32_t*)dst);    break;
-            case Type::UINT32: *(uint32_t*)dst = endian_swap<uint32_t, uint32_t>(*(uint32_t*)dst); break;
-            default: break;
-            }
-        }
+inline void make_arrow_array(ArrowArray * array, const size_t length, ArrowArrayHolder * holder)
+{
+    array->length = static_cast<int64_t>(length);
+    array->null_count = 0;
+    array->offset = 0;
+    array->n_buffers = static_cast<int64_t>(holder->buffers.size());
+    array->n_children = static_cast<int64_t>(holder->children.size());
+    array->buffers = holder->buffers.data();
+    array->children = holder->children.empty() ? nullptr : holder->children.data();
+    array->dictionary = nullptr;
+    array->release = release_arrow_array;
+    array->private_data = holder;
+}
 
-        return stride;
-    };
+inline void make_arrow_schema(ArrowSchema * schema, ArrowSchemaHolder * holder)
+{
+    schema->format = holder->format.c_str();
+    schema->name = holder->name.c_str();
+    schema->metadata = nullptr;
+    schema->flags = 0;
+    schema->n_children = static_cast<int64_t>(holder->children.size());
+    schema->children = holder->children.empty() ? nullptr : holder->children.data();
+    schema->dictionary = nullptr;
+    schema->release = release_arrow_schema;
+    schema->private_data = holder;
+}
 
-    if (isBinary)
-    {
-        read = [this, &listSize, &dummyCount, &read_list_binary](PropertyLookup & f, const PlyProperty & p, uint8_t * dest, size_t & destOffset, size_t destSize, std::istream & _is)
-        {
-            if (!p.isList)
-            {
-                return read_property_binary(f.prop_stride, dest + destOffset, destOffset, destSize, _is);
-            }
-            read_list_binary(p.listType, &listSize, dummyCount, f.list_stride, _is); // the list size
-            return read_property_binary(f.prop_stride * listSize, dest + destOffset, destOffset, destSize, _is); // properties in list
-        };
-        skip = [this, &listSize, &dummyCount, &read_list_binary](PropertyLookup & f, const PlyProperty & p, std::istream & _is) noexcept
-        {
-            if (!p.isList)
-            {
-                _is.read((char*)scratch, f.prop_stride);
-                return f.prop_stride;
-            }
-            read_list_binary(p.listType, &listSize, dummyCount, f.list_stride, _is); // the list size (does not count for memory alloc)
-            auto bytes_to_skip = f.prop_stride * listSize;
-            _is.ignore(bytes_to_skip);
-            return bytes_to_skip;
-        };
-    }
-    else
+// The Arrow format string of a primitive type
+inline const char * arrow_format(const Type t)
+{
+    static const char * formats[] = { "", "c", "C", "s", "S", "i", "I", "f", "g" };
+    return formats[static_cast<size_t>(t) < sizeof(formats) / sizeof(formats[0]) ? static_cast<size_t>(t) : 0];
+}
+
+// A primitive array over `values`, which it takes ownership of
+inline ArrowArray * make_arrow_values(Buffer & values, const size_t length)
+{
+    ArrowArrayHolder * holder = new ArrowArrayHolder();
+    holder->memory.push_back(values.release());
+    holder->buffers = { nullptr, holder->memory.back().data };
+    ArrowArray * array = new ArrowArray();
+    make_arrow_array(array, length, holder);
+    return array;
+}
+
+void export_arrow(const std::vector<PlyColumn> & columns, ArrowSchema * schema, ArrowArray * array)
+{
+    // Every column is checked before any buffer is handed over
+    struct Shape { size_t values_per_row; size_t values; };
+    std::vector<Shape> shapes;
+    const size_t rows = columns.empty() ? 0 : (columns.front().data ? columns.front().data->count : 0);
+    for (auto & c : columns)
     {
-        read = [this, &listSize, &dummyCount](PropertyLookup & f, const PlyProperty & p, uint8_t * dest, size_t & destOffset, size_t destSize, std::istream & _is)
+        if (!c.data) throw std::invalid_argument("column has no data: " + c.name);
+        const PlyData & d = *c.data;
+        const size_t width = type_stride(d.t);
+        if (width == 0) throw std::invalid_argument("column has no valid type: " + c.name);
+        if (d.count != rows) throw std::invalid_argument("columns differ in row count: " + c.name);
+        if (d.buffer.size_bytes() % width != 0) throw std::invalid_argument("column buffer is not a whole number of values: " + c.name);
+        const size_t values = d.buffer.size_bytes() / width;
+        if (d.isList)
         {
-            if (!p.isList)
-            {
-                read_property_ascii(p.propertyType, f.prop_stride, dest + destOffset, destOffset, destSize, _is);
-            }
-            else
-            {
-                dummyCount = 0;
-                read_property_ascii(p.listType, f.list_stride, &listSize, dummyCount, sizeof(listSize), _is); // the list size
-                for (size_t i = 0; i < listSize; ++i)
-                {
-                    read_property_ascii(p.propertyType, f.prop_stride, dest + destOffset, destOffset, destSize, _is);
-                }
-            }
-        };
-        skip = [this, &listSize, &dummyCount, &skip_ascii_buffer](PropertyLookup & f, const PlyProperty & p, std::istream & _is) noexcept
+            if ((d.offsetStride != 4 && d.offsetStride != 8) || d.offsets.size_bytes() < (rows + 1) * d.offsetStride) throw std::invalid_argument("list column has no row offsets: " + c.name);
+            if (d.list_offset(rows) > values) throw std::invalid_argument("list column offsets exceed its values: " + c.name);
+            if (d.offsetStride == 4 && d.list_offset(rows) > static_cast<uint64_t>(std::numeric_limits<int32_t>::max())) throw std::invalid_argument("list column has too many values for 32-bit offsets: " + c.name);
+            shapes.push_back(Shape{ 0, static_cast<size_t>(d.list_offset(rows)) });
+        }
+        else
         {
-            skip_ascii_buffer.clear();
-            if (p.isList)
-            {
-                dummyCount = 0;
-                read_property_ascii(p.listType, f.list_stride, &listSize, dummyCount, sizeof(listSize), _is); // the list size (does not count for memory alloc)
-                for (size_t i = 0; i < listSize; ++i) _is >> skip_ascii_buffer; // properties in list
-                return listSize * f.prop_stride;
-            }
-            _is >> skip_ascii_buffer;
-            return f.prop_stride;
-        };
+            if (rows ? values % rows != 0 : values != 0) throw std::invalid_argument("column does not hold a whole number of values per row: " + c.name);
+            shapes.push_back(Shape{ rows ? values / rows : 1, values });
+        }
     }
 
-    std::vector<std::vector<PropertyLookup>> element_property_lookup = make_property_lookup_table();
-    size_t element_idx = 0;
-    size_t property_idx = 0;
-    ParsingHelper * helper {nullptr};
-
-    // This is the inner import loop
-    for (auto & element : elements)
+    ArrowSchemaHolder * batch_schema = new ArrowSchemaHolder();
+    ArrowArrayHolder * batch = new ArrowArrayHolder();
+    batch_schema->format = "+s";
+    batch->buffers = { nullptr };
+    for (size_t i = 0; i < columns.size(); ++i)
     {
-        for (size_t count = 0; count < element.size; ++count)
-        {
-            property_idx = 0;
-            for (auto & property : element.properties)
-            {
-                PropertyLookup & lookup = element_property_lookup[element_idx][property_idx];
+        PlyData & d = *columns[i].data;
+        const Shape & shape = shapes[i];
+        ArrowSchemaHolder * field = new ArrowSchemaHolder();
+        field->name = columns[i].name;
+        ArrowArray * column = nullptr;
 
-                if (!lookup.skip)
-                {
-                    helper = lookup.helper;
-                    if (firstPass)
-                    {
-                        helper->cursor->totalSizeBytes += skip(lookup, property, is);
+        if (shape.values_per_row == 1) column = make_arrow_values(d.buffer, rows);
+        else
+        {
+            ArrowSchemaHolder * item = new ArrowSchemaHolder();
+            item->format = arrow_format(d.t);
+            item->name = "item";
+            field->children.push_back(new ArrowSchema());
+            make_arrow_schema(field->children.back(), item);
 
-                        // These lines will be changed when tinyply supports
-                        // variable length lists. We add it here so our header data structure
-                        // contains enough info to write it back out again (e.g. transcoding).
-                        if (property.listCount == 0) property.listCount = listSize;
-                        if (property.listCount != listSize) throw std::runtime_error("variable length lists are not supported yet.");
-                    }
-                    else
-                    {
-                        const size_t destSize = helper->data->buffer.size_bytes();
-                        read(lookup, property, helper->data->buffer.get(), helper->cursor->byteOffset, destSize, is);
-                    }
-                }
-                else
-                {
-                    skip(lookup, property, is);
-                }
-                property_idx++;
+            ArrowArrayHolder * holder = new ArrowArrayHolder();
+            holder->buffers = { nullptr };
+            if (d.isList)
+            {
+                field->format = d.offsetStride == 8 ? "+L" : "+l";
+                holder->memory.push_back(d.offsets.release());
+                holder->buffers.push_back(holder->memory.back().data);
+                d.offsetStride = 0;
             }
+            else field->format = "+w:" + std::to_string(shape.values_per_row);
+            holder->children.push_back(make_arrow_values(d.buffer, shape.values));
+            column = new ArrowArray();
+            make_arrow_array(column, rows, holder);
         }
-        element_idx++;
-    }
+        if (field->format.empty()) field->format = arrow_format(d.t);
 
-    // Reset istream position to the start of the data
-    if (firstPass) is.seekg(start, is.beg);
+        batch_schema->children.push_back(new ArrowSchema());
+        make_arrow_schema(batch_schema->children.back(), field);
+        batch->children.push_back(column);
+        d.count = 0;
+    }
+    make_arrow_schema(schema, batch_schema);
+    make_arrow_array(array, rows, batch);
 }
 
 // Wrap the public interface:
 
+const size_t PlyFile::index_checkpoint_rows;
+
 PlyFile::PlyFile() { impl.reset(new PlyFileImpl()); }
 PlyFile::~PlyFile() { }
 bool PlyFile::parse_header(std::istream & is) { return impl->parse_header(is); }
+bool PlyFile::parse_header(const uint8_t * data, const size_t size) { return impl->parse_header(data, size); }
 void PlyFile::read(std::istream & is) { return impl->read(is); }
+void PlyFile::read(const uint8_t * data, const size_t size) { return impl->read(data, size); }
+void PlyFile::read_parallel(std::istream & is, const size_t thread_count) { return impl->read_parallel(is, thread_count); }
+void PlyFile::read_parallel(const uint8_t * data, const size_t size, const size_t thread_count) { return impl->read_parallel(data, size, thread_count); }
+void PlyFile::read_parallel(const size_t thread_count) { return impl->read_parallel(thread_count); }
+bool PlyFile::open_mapped(const std::string & path) { return impl->open_mapped(path); }
+void PlyFile::read() { return impl->read_mapped(); }
+void PlyFile::read_range(const std::string & elementKey, const size_t row_begin, const size_t row_count) { return impl->read_range(elementKey, row_begin, row_count); }
+void PlyFile::read_range(const uint8_t * data, const size_t size, const std::string & elementKey, const size_t row_begin, const size_t row_count) { return impl->read_range(data, size, elementKey, row_begin, row_count); }
+void PlyFile::read_range(std::istream & is, const std::string & elementKey, const size_t row_begin, const size_t row_count) { return impl->read_range(is, elementKey, row_begin, row_count); }
 void PlyFile::write(std::ostream & os, bool isBinary) { return impl->write(os, isBinary); }
+void PlyFile::write_parallel(std::ostream & os, bool isBinary, const size_t thread_count) { return impl->write_parallel(os, isBinary, thread_count); }
+void PlyFile::use_arena(std::shared_ptr<PlyArena> arena) { impl->arena = arena; }
+void PlyFile::set_stats_sink(std::function<void(const PlyReadStats &)> sink) { impl->set_stats_sink(std::move(sink)); }
+bool PlyFile::read_next(std::istream & is) { return impl->read_next(is); }
+bool PlyFile::read_next(const uint8_t * data, const size_t size) { return impl->read_next(data, size); }
+PlyStream PlyFile::begin_stream(std::istream & is)
+{
+    PlyStream stream;
+    stream.impl = std::make_shared<PlyStream::PlyStreamImpl>(impl.get(), ByteSource(is));
+    impl->begin_stream(*stream.impl);
+    return stream;
+}
+PlyStream PlyFile::begin_stream(const uint8_t * data, const size_t size)
+{
+    if (size < impl->payloadOffset) throw std::runtime_error("unexpected EOF. malformed file?");
+    PlyStream stream;
+    stream.impl = std::make_shared<PlyStream::PlyStreamImpl>(impl.get(), ByteSource(data + impl->payloadOffset, size - impl->payloadOffset));
+    impl->begin_stream(*stream.impl);
+    return stream;
+}
+PlyStream PlyFile::begin_stream()
+{
+    if (!impl->mapping) throw std::runtime_error("no file has been mapped; call open_mapped(...) first");
+    PlyStream stream = begin_stream(impl->mapping->data, impl->mapping->size);
+    stream.impl->src.mapping = impl->mapping;
+    return stream;
+}
+bool PlyFile::read(std::istream & is, PlyVisitor & visitor, const size_t batch_rows) { return impl->visit(*begin_stream(is).impl, visitor, batch_rows); }
+bool PlyFile::read(const uint8_t * data, const size_t size, PlyVisitor & visitor, const size_t batch_rows) { return impl->visit(*begin_stream(data, size).impl, visitor, batch_rows); }
+bool PlyFile::read(PlyVisitor & visitor, const size_t batch_rows) { return impl->visit(*begin_stream().impl, visitor, batch_rows); }
+size_t PlyStream::next_chunk(const size_t max_rows) { return impl->file->next_chunk(*impl, max_rows); }
+std::string PlyStream::element() const { return impl->file->elements[impl->chunk_element].name; }
+size_t PlyStream::first_row() const { return impl->chunk_first_row; }
+void PlyFile::set_ascii_precision(const int decimals) { return impl->set_ascii_precision(decimals); }
+void PlyFile::set_big_endian(const bool bigEndian) { return impl->set_big_endian(bigEndian); }
 std::vector<PlyElement> PlyFile::get_elements() const { return impl->elements; }
+std::vector<int64_t> PlyFile::get_element_offsets() const { return impl->elementOffsets; }
+bool PlyFile::use_sidecar_index(const std::string & plyPath) { return impl->use_sidecar_index(plyPath); }
 std::vector<std::string> & PlyFile::get_comments() { return impl->comments; }
 std::vector<std::string> PlyFile::get_info() const { return impl->objInfo; }
 bool PlyFile::is_binary_file() const { return impl->isBinary; }
@@ -974,7 +4795,25 @@ std::shared_ptr<PlyData> PlyFile::request_properties_from_element(const std::str
     const std::vector<std::string> propertyKeys,
     const uint32_t list_size_hint)
 {
-    return impl->request_properties_from_element(elementKey, propertyKeys, list_size_hint);
+    return impl->request_properties_from_element(elementKey, propertyKeys, list_size_hint, Type::INVALID);
+}
+std::shared_ptr<PlyData> PlyFile::request_properties_from_element(const std::string & elementKey,
+    const std::vector<std::string> propertyKeys,
+    const Type targetType, const uint32_t list_size_hint)
+{
+    if (targetType == Type::INVALID) throw std::invalid_argument("`targetType` must be a valid type");
+    return impl->request_properties_from_element(elementKey, propertyKeys, list_size_hint, targetType);
+}
+std::shared_ptr<PlyData> PlyFile::request_properties_from_element(const std::string & elementKey,
+    const std::vector<std::string> propertyKeys,
+    uint8_t * destination, const size_t capacity, const size_t stride, const Type targetType)
+{
+    return impl->request_properties_from_element(elementKey, propertyKeys, destination, capacity, stride, targetType);
+}
+std::vector<std::shared_ptr<PlyData>> PlyFile::request_columns_from_element(const std::string & elementKey,
+    const std::vector<std::string> propertyKeys, const Type targetType, const uint32_t list_size_hint)
+{
+    return impl->request_columns_from_element(elementKey, propertyKeys, targetType, list_size_hint);
 }
 void PlyFile::add_properties_to_element(const std::string & elementKey,
     const std::vector<std::string> propertyKeys,
@@ -982,6 +4821,16 @@ void PlyFile::add_properties_to_element(const std::string & elementKey,
 {
     return impl->add_properties_to_element(elementKey, propertyKeys, type, count, data, listType, listCount);
 }
+void PlyFile::add_list_property_to_element(const std::string & elementKey, const std::string & propertyKey,
+    const Type type, const size_t count, const uint8_t * data, const Type listType, const uint32_t * offsets)
+{
+    return impl->add_list_property_to_element(elementKey, propertyKey, type, count, data, listType, reinterpret_cast<const uint8_t *>(offsets), sizeof(uint32_t));
+}
+void PlyFile::add_list_property_to_element(const std::string & elementKey, const std::string & propertyKey,
+    const Type type, const size_t count, const uint8_t * data, const Type listType, const uint64_t * offsets)
+{
+    return impl->add_list_property_to_element(elementKey, propertyKey, type, count, data, listType, reinterpret_cast<const uint8_t *>(offsets), sizeof(uint64_t));
+}
 
 } // end namespace tinyply
 